@@ -0,0 +1,53 @@
+#ifndef BOUNDED_QUEUE_H__
+#define BOUNDED_QUEUE_H__
+
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+
+// Blocking multi-producer/multi-consumer queue holding at most `capacity` items.
+template<typename T>
+class BoundedQueue {
+public:
+	BoundedQueue(std::size_t capacity) : m_capacity(capacity), m_closed(false) {}
+
+	void Push(T&& item) {
+		std::unique_lock<std::mutex> lock(m_lock);
+		m_notFull.wait(lock, [this]{ return m_items.size() < m_capacity || m_closed; });
+		m_items.push_back(std::move(item));
+		m_notEmpty.notify_one();
+	}
+
+	// waits for the next item, returns false once the queue is closed and drained
+	bool Pop(T& item) {
+		std::unique_lock<std::mutex> lock(m_lock);
+		m_notEmpty.wait(lock, [this]{ return !m_items.empty() || m_closed; });
+		if (m_items.empty()) return false;
+
+		item = std::move(m_items.front());
+		m_items.pop_front();
+		m_notFull.notify_one();
+		return true;
+	}
+
+	void Close() {
+		std::lock_guard<std::mutex> lock(m_lock);
+		m_closed = true;
+		m_notEmpty.notify_all();
+		m_notFull.notify_all();
+	}
+
+private:
+	BoundedQueue(const BoundedQueue&);
+	BoundedQueue& operator=(const BoundedQueue&);
+
+private:
+	const std::size_t m_capacity;
+	bool m_closed;
+	std::deque<T> m_items;
+	std::mutex m_lock;
+	std::condition_variable m_notEmpty;
+	std::condition_variable m_notFull;
+};
+
+#endif // BOUNDED_QUEUE_H__
@@ -0,0 +1,415 @@
+#include "Cache.h"
+#include "FileSystem.h"
+#include <cstring>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+
+namespace {
+	const char MAGIC[4] = { 'D', 'X', 'P', 'C' };
+	const unsigned VERSION = 2; //!< to be raised whenever the extraction or the format changes
+	const unsigned long long FNV_PRIME = 0x100000001b3ULL;
+
+	// Appends records to a byte buffer in native byte order, the cache is not shared between machines.
+	class Writer {
+	public:
+		explicit Writer(std::string& out) : m_out(out) {}
+
+		void Raw(const void* data, std::size_t size) { m_out.append(static_cast<const char*>(data), size); }
+		void U8(unsigned char value) { Raw(&value, sizeof(value)); }
+		void U32(unsigned value) { Raw(&value, sizeof(value)); }
+		void U64(unsigned long long value) { Raw(&value, sizeof(value)); }
+		void Str(const string& value) {
+			U32(static_cast<unsigned>(value.size()));
+			Raw(value.data(), value.size() * sizeof(_TCHAR));
+		}
+		void Str(const Symbol& value) { Str(value.str()); }
+
+		void Write(const Class& item) {
+			Str(item.name);
+			Str(item.doxygenId);
+			Str(item.filename);
+			Str(item.description);
+			U8(static_cast<unsigned char>(item.type));
+			U8(item.templated);
+			U8(item.interface);
+			U32(static_cast<unsigned>(item.inheritance.size()));
+			for (const auto& inheritance: item.inheritance) {
+				Str(inheritance.classId);
+				U8(static_cast<unsigned char>(inheritance.protLevel));
+				U8(inheritance.Virtual);
+			}
+			U32(static_cast<unsigned>(item.methods.size()));
+			for (const auto& method: item.methods) {
+				Str(method.name);
+				Str(method.doxygenId);
+				Str(method.description);
+				Str(method.returnType);
+				U8(method.Const);
+				U8(method.Virtual);
+				U8(method.Override);
+				U32(static_cast<unsigned>(method.params.size()));
+				for (const auto& param: method.params) {
+					Str(param.type);
+					Str(param.name);
+				}
+				U8(static_cast<unsigned char>(method.protectionLevel));
+				Str(method.locationFile);
+				Str(method.bodyBeginLine);
+				Str(method.bodyEndLine);
+			}
+			U32(static_cast<unsigned>(item.members.size()));
+			for (const auto& member: item.members) {
+				Str(member.name);
+				Str(member.type);
+				Str(member.description);
+				U8(static_cast<unsigned char>(member.protectionLevel));
+			}
+		}
+
+		void Write(const ClassManager::Definitions& definitions) {
+			U32(static_cast<unsigned>(definitions.classes.size()));
+			for (const auto& item: definitions.classes) {
+				Write(item);
+			}
+			U32(static_cast<unsigned>(definitions.namespaces.size()));
+			for (const auto& item: definitions.namespaces) {
+				Str(item);
+			}
+		}
+
+		void Write(const std::vector<string>& locations) {
+			U32(static_cast<unsigned>(locations.size()));
+			for (const auto& location: locations) {
+				Str(location);
+			}
+		}
+
+		void Write(const ClassManager::Usages& usages) {
+			U32(static_cast<unsigned>(usages.size()));
+			for (const auto& item: usages) {
+				Str(item.first);
+				Str(item.second.sourceMethodId);
+				Str(item.second.connectionCode);
+				Str(item.second.targetId);
+				U8(static_cast<unsigned char>(item.second.type));
+				U8(item.second.certain);
+			}
+		}
+
+	private:
+		std::string& m_out;
+	};
+
+	// Reads the records of Writer back. Running past the end sets the reader to failed, so
+	// a truncated cache file only costs a reparse.
+	class Reader {
+	public:
+		Reader(const char* data, std::size_t size) : m_data(data), m_end(data + size) {}
+
+		bool Ok() const { return m_data != nullptr; }
+		bool AtEnd() const { return m_data == m_end; }
+
+		void Raw(void* data, std::size_t size) {
+			if (m_data && static_cast<std::size_t>(m_end - m_data) >= size) {
+				std::memcpy(data, m_data, size);
+				m_data += size;
+			} else {
+				std::memset(data, 0, size);
+				m_data = nullptr;
+			}
+		}
+		unsigned char U8() { unsigned char value; Raw(&value, sizeof(value)); return value; }
+		unsigned U32() { unsigned value; Raw(&value, sizeof(value)); return value; }
+		unsigned long long U64() { unsigned long long value; Raw(&value, sizeof(value)); return value; }
+		bool Bool() { return U8() != 0; }
+		string Str() {
+			const std::size_t size = U32();
+			if (!m_data || static_cast<std::size_t>(m_end - m_data) / sizeof(_TCHAR) < size) {
+				m_data = nullptr;
+				return string();
+			}
+			string value(size, _T('\0'));
+			Raw(&value[0], size * sizeof(_TCHAR));
+			return value;
+		}
+		Symbol Sym() { return Symbol(Str()); }
+		std::string Bytes(std::size_t size) {
+			if (!m_data || static_cast<std::size_t>(m_end - m_data) < size) {
+				m_data = nullptr;
+				return std::string();
+			}
+			std::string value(m_data, size);
+			m_data += size;
+			return value;
+		}
+
+		void Read(Class& item) {
+			item.name = Sym();
+			item.doxygenId = Sym();
+			item.filename = Sym();
+			item.description = Str();
+			item.type = static_cast<Class::EType>(U8());
+			item.templated = Bool();
+			item.interface = Bool();
+			for (unsigned i = U32(); i > 0 && Ok(); i--) {
+				Inheritance inheritance;
+				inheritance.classId = Sym();
+				inheritance.protLevel = static_cast<EProtectionLevel>(U8());
+				inheritance.Virtual = Bool();
+				item.inheritance.push_back(std::move(inheritance));
+			}
+			for (unsigned i = U32(); i > 0 && Ok(); i--) {
+				Method method;
+				method.name = Sym();
+				method.doxygenId = Sym();
+				method.description = Str();
+				method.returnType = Sym();
+				method.Const = Bool();
+				method.Virtual = Bool();
+				method.Override = Bool();
+				for (unsigned j = U32(); j > 0 && Ok(); j--) {
+					Method::Param param;
+					param.type = Sym();
+					param.name = Sym();
+					method.params.push_back(std::move(param));
+				}
+				method.protectionLevel = static_cast<EProtectionLevel>(U8());
+				method.locationFile = Sym();
+				method.bodyBeginLine = Str();
+				method.bodyEndLine = Str();
+				item.methods.push_back(std::move(method));
+			}
+			for (unsigned i = U32(); i > 0 && Ok(); i--) {
+				Member member;
+				member.name = Sym();
+				member.type = Sym();
+				member.description = Str();
+				member.protectionLevel = static_cast<EProtectionLevel>(U8());
+				item.members.push_back(std::move(member));
+			}
+		}
+
+		void Read(ClassManager::Definitions& definitions) {
+			for (unsigned i = U32(); i > 0 && Ok(); i--) {
+				Class item;
+				Read(item);
+				definitions.classes.push_back(std::move(item));
+			}
+			for (unsigned i = U32(); i > 0 && Ok(); i--) {
+				definitions.namespaces.push_back(Sym());
+			}
+		}
+
+		void Read(std::vector<string>& locations) {
+			for (unsigned i = U32(); i > 0 && Ok(); i--) {
+				locations.push_back(Str());
+			}
+		}
+
+		void Read(ClassManager::Usages& usages) {
+			for (unsigned i = U32(); i > 0 && Ok(); i--) {
+				ClassManager::MemberUsage usage;
+				const Symbol classId = Sym();
+				usage.sourceMethodId = Sym();
+				usage.connectionCode = Str();
+				usage.targetId = Sym();
+				usage.type = static_cast<ClassManager::EMemberUsageType>(U8());
+				usage.certain = Bool();
+				usages.push_back(std::make_pair(classId, std::move(usage)));
+			}
+		}
+
+	private:
+		const char* m_data; //!< nullptr once failed
+		const char* const m_end;
+	};
+
+	string CacheFilename(const stringRef& directory)
+	{
+		return FileSystem::Combine(directory, _T("doxygenParser.cache"));
+	}
+}
+
+Cache::Cache(const stringRef& directory) : m_filename(CacheFilename(directory)), m_hits(0), m_misses(0)
+{
+	std::ifstream file(m_filename.c_str(), std::ios::binary);
+	const std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+	Reader reader(content.data(), content.size());
+	char magic[sizeof(MAGIC)];
+	reader.Raw(magic, sizeof(magic));
+	if (std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0 || reader.U32() != VERSION || reader.U32() != sizeof(_TCHAR)) return;
+
+	while (reader.Ok() && !reader.AtEnd()) {
+		EntryKey key;
+		key.first = reader.U64();
+		key.second = reader.U64();
+		std::string data = reader.Bytes(reader.U32());
+		if (reader.Ok()) {
+			m_loaded[key].swap(data);
+		}
+	}
+}
+
+// FNV-1a over 64 bit words, with a final mix so the low bits depend on the whole input
+Cache::Hasher::Hasher(unsigned long long size) : m_hash(0xcbf29ce484222325ULL ^ size), m_wordSize(0)
+{
+}
+
+void Cache::Hasher::Update(const void* data, std::size_t size)
+{
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	if (m_wordSize) {
+		const std::size_t count = size < sizeof(m_word) - m_wordSize ? size : sizeof(m_word) - m_wordSize;
+		std::memcpy(m_word + m_wordSize, bytes, count);
+		m_wordSize += count;
+		bytes += count;
+		size -= count;
+		if (m_wordSize < sizeof(m_word)) return;
+
+		unsigned long long word;
+		std::memcpy(&word, m_word, sizeof(word));
+		m_hash = (m_hash ^ word) * FNV_PRIME;
+		m_wordSize = 0;
+	}
+
+	std::size_t i = 0;
+	for (; i + sizeof(unsigned long long) <= size; i += sizeof(unsigned long long)) {
+		unsigned long long word;
+		std::memcpy(&word, bytes + i, sizeof(word));
+		m_hash = (m_hash ^ word) * FNV_PRIME;
+	}
+	m_wordSize = size - i;
+	std::memcpy(m_word, bytes + i, m_wordSize);
+}
+
+Cache::Key Cache::Hasher::Final() const
+{
+	unsigned long long hash = m_hash;
+	for (std::size_t i = 0; i < m_wordSize; i++) {
+		hash = (hash ^ m_word[i]) * FNV_PRIME;
+	}
+
+	hash ^= hash >> 33;
+	hash *= 0xff51afd7ed558ccdULL;
+	hash ^= hash >> 33;
+	return hash;
+}
+
+Cache::Key Cache::Hash(const void* data, std::size_t size)
+{
+	Hasher hasher(size);
+	hasher.Update(data, size);
+	return hasher.Final();
+}
+
+bool Cache::Find(const EntryKey& key, std::string& data)
+{
+	const Entries::const_iterator entry = m_loaded.find(key);
+	if (entry == m_loaded.end()) return false;
+
+	data = entry->second;
+	return true;
+}
+
+void Cache::Keep(const EntryKey& key, std::string&& data)
+{
+	std::lock_guard<std::mutex> guard(m_lock);
+	m_used[key].swap(data);
+}
+
+bool Cache::Load(Key file, ClassManager::Definitions& definitions)
+{
+	const EntryKey key(file, DEFINITIONS);
+	std::string data;
+	ClassManager::Definitions loaded;
+	bool found = Find(key, data);
+	if (found) {
+		Reader reader(data.data(), data.size());
+		reader.Read(loaded);
+		found = reader.Ok();
+	}
+	if (!found) {
+		m_misses++;
+		return false;
+	}
+
+	std::move(loaded.classes.begin(), loaded.classes.end(), std::back_inserter(definitions.classes));
+	std::move(loaded.namespaces.begin(), loaded.namespaces.end(), std::back_inserter(definitions.namespaces));
+	Keep(key, std::move(data));
+	m_hits++;
+	return true;
+}
+
+void Cache::Store(Key file, const ClassManager::Definitions& definitions)
+{
+	std::string data;
+	Writer(data).Write(definitions);
+	Keep(EntryKey(file, DEFINITIONS), std::move(data));
+}
+
+bool Cache::Load(Key file, const ModelKey& model, ClassManager::Usages& usages)
+{
+	const EntryKey key(file, USAGES);
+	std::string data;
+	ClassManager::Usages loaded;
+	bool found = Find(key, data);
+	if (found) {
+		// the usages are still valid if the model parts they depend on are unchanged
+		Reader reader(data.data(), data.size());
+		std::vector<string> locations;
+		reader.Read(locations);
+		const Key stored = reader.U64();
+		reader.Read(loaded);
+		found = reader.Ok() && stored == model(locations);
+	}
+	if (!found) {
+		m_misses++;
+		return false;
+	}
+
+	std::move(loaded.begin(), loaded.end(), std::back_inserter(usages));
+	Keep(key, std::move(data));
+	m_hits++;
+	return true;
+}
+
+void Cache::Store(Key file, const std::vector<string>& locations, Key model, const ClassManager::Usages& usages)
+{
+	std::string data;
+	Writer writer(data);
+	writer.Write(locations);
+	writer.U64(model);
+	writer.Write(usages);
+	Keep(EntryKey(file, USAGES), std::move(data));
+}
+
+void Cache::Save() const
+{
+	std::string content;
+	Writer writer(content);
+	writer.Raw(MAGIC, sizeof(MAGIC));
+	writer.U32(VERSION);
+	writer.U32(sizeof(_TCHAR));
+	for (const auto& entry: m_used) {
+		writer.U64(entry.first.first);
+		writer.U64(entry.first.second);
+		writer.U32(static_cast<unsigned>(entry.second.size()));
+		writer.Raw(entry.second.data(), entry.second.size());
+	}
+
+	// written aside and swapped in, an interrupted run must not leave a truncated cache behind
+	const string temporary = m_filename + _T(".tmp");
+	{
+		std::ofstream file(temporary.c_str(), std::ios::binary | std::ios::trunc);
+		file.write(content.data(), content.size());
+		if (!file) return;
+	}
+#ifdef _WIN32
+	_tremove(m_filename.c_str());
+	_trename(temporary.c_str(), m_filename.c_str());
+#else
+	std::rename(temporary.c_str(), m_filename.c_str());
+#endif
+}
@@ -0,0 +1,84 @@
+#ifndef CACHE_H__
+#define CACHE_H__
+
+#include "types.h"
+#include "ClassManager.h"
+#include <atomic>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <vector>
+
+// On-disk cache of what the previous runs extracted from the input files, so a rerun only
+// parses the files that changed. The entries are keyed by a hash of the file content:
+// - the classes and namespaces ProcessDef collected from a definition file,
+// - the usages ProcessFileDef found in a file compound. These also depend on the model,
+//   though only on the parts ClassManager::DescribeFileModel gives for the locations of the
+//   file compounds. The locations are stored with the usages, so the key of the model parts
+//   is checked before the file is parsed, and other changes to the model keep them valid.
+// The cache lives in a single file of the given directory. Save writes it back with the
+// entries used by this run only, so it does not grow with files long gone.
+class Cache {
+public:
+	typedef unsigned long long Key;
+
+	explicit Cache(const stringRef& directory);
+
+	static Key Hash(const void* data, std::size_t size);
+
+	// Hash of `size` bytes fed in parts of any size, e.g. as a file is streamed. Gives the
+	// same key as Hash of the whole.
+	class Hasher {
+	public:
+		explicit Hasher(unsigned long long size);
+		void Update(const void* data, std::size_t size);
+		Key Final() const;
+
+	private:
+		unsigned long long m_hash;
+		unsigned char m_word[sizeof(unsigned long long)]; //!< bytes of a word not complete yet
+		std::size_t m_wordSize;
+	};
+
+	// appends the cached definitions of the file, if there are any
+	bool Load(Key file, ClassManager::Definitions& definitions);
+	void Store(Key file, const ClassManager::Definitions& definitions);
+
+	// Key of the model parts the usages of file compounds at the given locations depend on.
+	typedef std::function<Key(const std::vector<string>& locations)> ModelKey;
+
+	// appends the cached usages of the file, if `model` gives the key they were stored with
+	// for the locations stored with them
+	bool Load(Key file, const ModelKey& model, ClassManager::Usages& usages);
+	void Store(Key file, const std::vector<string>& locations, Key model, const ClassManager::Usages& usages);
+
+	// files loaded from the cache and files looked up in vain, so far
+	unsigned Hits() const { return m_hits; }
+	unsigned Misses() const { return m_misses; }
+
+	void Save() const;
+
+private:
+	Cache(const Cache&);
+	Cache& operator=(const Cache&);
+
+	enum EEntry {
+		DEFINITIONS,
+		USAGES
+	};
+
+	typedef std::pair<Key, Key> EntryKey; //!< file, EEntry
+	typedef std::map<EntryKey, std::string> Entries; //!< serialized records
+
+	bool Find(const EntryKey& key, std::string& data);
+	void Keep(const EntryKey& key, std::string&& data);
+
+private:
+	string m_filename;
+	Entries m_loaded; //!< read only after the construction
+	Entries m_used; //!< entries to be saved
+	std::mutex m_lock; //!< for m_used
+	std::atomic<unsigned> m_hits, m_misses;
+};
+
+#endif // CACHE_H__
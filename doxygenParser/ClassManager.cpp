@@ -1,9 +1,14 @@
 #include "ClassManager.h"
 #include "JsonWriter.h"
+#include "FileSystem.h"
+#include "Keyword.h"
+#include "Tokenizer.h"
+#include <algorithm>
 #include <set>
 #include <sstream>
 #include <iostream>
 #include <regex>
+#include <unordered_map>
 
 
 
@@ -18,157 +23,333 @@ const _TCHAR* GetProtectionLevel(EProtectionLevel level) {
 	return type;
 }
 
-
-void ClassManager::Initialize()
-{
-	CalculateNamespaces(initNamespaces);
-	CalculateClasses(initClasses);
-	CalculateMethods();
+EProtectionLevel ParseProtectionLevel(const stringRef& prot) {
+	switch(DecodeKeyword(prot)) {
+	case KW_PUBLIC: return PUBLIC;
+	case KW_PROTECTED: return PROTECTED;
+	case KW_PRIVATE: return PRIVATE;
+	default: return PACKAGE;
+	}
 }
 
-void ClassManager::CalculateNamespaces(const std::vector<string>& namespaces)
-{
-	for (const auto& item: namespaces) {
-		Namespace newNamespace;
-		newNamespace.name = GetLastId(item);
-		newNamespace.parentId = GetWithoutLastId(item);
-		m_namespaces.insert(std::map<string, Namespace>::value_type(item, std::move(newNamespace)));
+namespace {
+	template<typename Entry>
+	void Reindex(const std::vector<Entry>& entries, SymbolIndex& index)
+	{
+		index.Clear();
+		for (std::size_t i = 0; i < entries.size(); i++) {
+			index.Insert(entries[i].id, i);
+		}
 	}
-}
 
-std::vector<string> split(const string &s, _TCHAR delim) {
-	std::vector<string> elems;
-	std::basic_stringstream<_TCHAR> ss(s);
-	string item;
-	while (std::getline(ss, item, delim)) {
-		elems.push_back(item);
+	// sorts the entries by id and indexes them at their new positions
+	template<typename Entry>
+	void SortById(std::vector<Entry>& entries, SymbolIndex& index)
+	{
+		std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.id < b.id; });
+		Reindex(entries, index);
 	}
-	return elems;
-}
 
-template<std::size_t Size>
-std::vector<string> split(const string &s, const _TCHAR (&delim)[Size]) {
-	std::vector<string> elems = split(s, delim[0]);
-	for (std::size_t i = 1; i < Size; i++) {
-		std::vector<string> iElems;
-		for (const auto& item: elems) {
-			for (const auto& elem: split(item, delim[i])) {
-				iElems.push_back(elem);
+	// removes the entries not flagged in `keep`, keeping the order of the rest
+	template<typename Entry>
+	void EraseUnflagged(std::vector<Entry>& entries, SymbolIndex& index, const std::vector<bool>& keep)
+	{
+		std::size_t kept = 0;
+		for (std::size_t i = 0; i < entries.size(); i++) {
+			if (!keep[i]) continue;
+			if (kept != i) {
+				entries[kept] = std::move(entries[i]);
 			}
+			kept++;
 		}
+		if (kept == entries.size()) return;
 
-		elems.swap(iElems);
+		entries.erase(entries.begin() + kept, entries.end());
+		Reindex(entries, index);
 	}
-	return elems;
-}
 
-void ClassManager::CalculateClasses(const std::vector<Class>& classes)
-{
-	std::set<string> ids;
-	for (const auto& item: classes) {
-		ids.insert(item.name);
+	const DelimiterSet TYPE_DELIMITERS(_T(" \t&*")); //!< between the words of a type
+	const DelimiterSet TEMPLATE_DELIMITERS(_T(",<> \t&*")); //!< between the words of template arguments
+	const DelimiterSet ID_DELIMITERS(_T(":")); //!< between the parts of a qualified name
+
+	bool IsWordChar(_TCHAR c)
+	{
+		return (c >= _T('a') && c <= _T('z')) || (c >= _T('A') && c <= _T('Z')) || (c >= _T('0') && c <= _T('9')) || c == _T('_');
 	}
 
-	std::vector<string> utilityClasses;
+	// Finds the names a type refers to, as matching the pattern (^|.*[^\w])name($|[^\w:].*)
+	// for every name would. A name made of word characters and `:` can only match a part of a
+	// run of them, which ends the run and starts it or follows a `:`. These parts are looked up
+	// in a hash table, the few other names are searched for.
+	class TypeMatcher {
+	public:
+		// `names` has to outlive the matcher
+		explicit TypeMatcher(const std::map<string, Symbol>& names) {
+			for (auto it = names.begin(); it != names.end(); ++it) {
+				const string& name = it->first;
+				bool regular = !name.empty();
+				for (std::size_t i = 0; regular && i < name.size(); i++) {
+					regular = IsWordChar(name[i]) || name[i] == _T(':');
+				}
+				if (regular) {
+					m_regular.insert(std::make_pair(stringRef(name.c_str(), name.size()), m_entries.size()));
+				} else if (!name.empty()) {
+					m_irregular.push_back(m_entries.size());
+				}
+				m_entries.push_back(&*it);
+			}
+		}
+
+		// the class of the name at `index`, in the order of the names
+		const Symbol& Target(std::size_t index) const { return m_entries[index]->second; }
+
+		// indexes of the names `type` refers to, ascending
+		void Match(const stringRef& type, std::vector<std::size_t>& found) const {
+			found.clear();
+			const _TCHAR* const str = type.str();
+			const std::size_t size = type.size();
+
+			// `.` matches no line terminator, none may be before the character preceding the
+			// name or after the one following it
+			std::size_t firstBreak = size;
+			std::size_t lastBreak = 0;
+			for (std::size_t i = 0; i < size; i++) {
+				if (str[i] == _T('\n') || str[i] == _T('\r')) {
+					if (firstBreak == size) {
+						firstBreak = i;
+					}
+					lastBreak = i;
+				}
+			}
+			auto bounded = [&](std::size_t begin, std::size_t end) -> bool {
+				if (begin > 0 && (IsWordChar(str[begin - 1]) || firstBreak < begin - 1)) return false;
+				if (end < size && (IsWordChar(str[end]) || str[end] == _T(':') || (firstBreak != size && lastBreak > end))) return false;
+				return true;
+			};
+
+			for (std::size_t start = 0; start < size;) {
+				if (!IsWordChar(str[start]) && str[start] != _T(':')) {
+					start++;
+					continue;
+				}
+				std::size_t end = start;
+				while (end < size && (IsWordChar(str[end]) || str[end] == _T(':'))) {
+					end++;
+				}
+				for (std::size_t begin = start; begin < end; begin++) {
+					if (begin != start && str[begin - 1] != _T(':')) continue;
+					if (!bounded(begin, end)) continue;
 
-	for (const auto& item: classes) {
-		ClassEntry newEntry;
-		newEntry.name = GetLastId(item.name);
-		newEntry.data = item;
-		string prefix = GetWithoutLastId(item.name);
+					const auto it = m_regular.find(stringRef(str + begin, end - begin));
+					if (it != m_regular.end()) {
+						found.push_back(it->second);
+					}
+				}
+				start = end;
+			}
 
-		// newEntry.parentId
-		if (ids.find(prefix) != ids.end()) {
-			newEntry.parentId = prefix;
+			for (const auto index: m_irregular) {
+				const string& name = m_entries[index]->first;
+				for (const _TCHAR* at = std::search(str, str + size, name.begin(), name.end()); at != str + size; at = std::search(at + 1, str + size, name.begin(), name.end())) {
+					const std::size_t begin = static_cast<std::size_t>(at - str);
+					if (bounded(begin, begin + name.size())) {
+						found.push_back(index);
+						break;
+					}
+				}
+			}
 
-			// all member classes are treated as utility classes
-			newEntry.utility = true;
+			std::sort(found.begin(), found.end());
+			found.erase(std::unique(found.begin(), found.end()), found.end());
 		}
 
-		/*// all templated classes are treated as utility classes
-		if (item.templated)	{
-			newEntry.utility = true;
-		}*/
+	private:
+		TypeMatcher(const TypeMatcher&);
+		TypeMatcher& operator=(const TypeMatcher&);
 
-		// newEntry.namespaceId
-		while (!prefix.empty()) {
-			if (ids.find(prefix) == ids.end() &&
-				m_namespaces.find(prefix) != m_namespaces.end()) {
-					newEntry.namespaceId = prefix;
-					break;
-			}
-			prefix = GetWithoutLastId(prefix);
-		}
+		std::vector<const std::map<string, Symbol>::value_type*> m_entries; //!< in the order of the names
+		std::unordered_map<stringRef, std::size_t> m_regular; //!< names of word characters and `:` -> index
+		std::vector<std::size_t> m_irregular; //!< indexes of the other names
+	};
+}
 
-		//newEntry.connections
-		for (const auto& parent: item.inheritance) {
-			for (auto& connection: GetConnections(parent.classId, newEntry.namespaceId, ids, parent.protLevel, parent.Virtual)) {
-				newEntry.connections.push_back(connection);
+const ClassManager::ClassEntry* ClassManager::FindClass(const Symbol& id) const
+{
+	const std::size_t position = m_classIndex.Find(id);
+	return position == SymbolIndex::NOT_FOUND ? nullptr : &m_classes[position];
+}
 
-				// all directly inherited classes are treated as utility classes
-				if (connection.type == DIRECT_INHERITANCE) {
-					utilityClasses.push_back(connection.targetId);
-				}
+ClassManager::ClassEntry* ClassManager::FindClass(const Symbol& id)
+{
+	const std::size_t position = m_classIndex.Find(id);
+	return position == SymbolIndex::NOT_FOUND ? nullptr : &m_classes[position];
+}
+
+const ClassManager::Namespace* ClassManager::FindNamespace(const Symbol& id) const
+{
+	const std::size_t position = m_namespaceIndex.Find(id);
+	return position == SymbolIndex::NOT_FOUND ? nullptr : &m_namespaces[position];
+}
+
+
+void ClassManager::Initialize()
+{
+	CalculateNamespaces(initNamespaces);
+	for (const auto& item: initClasses) {
+		m_classNames.Add(item.name);
+	}
+	CalculateClasses(initClasses);
+	CalculateMethods();
+}
+
+void ClassManager::CalculateNamespaces(const std::vector<Symbol>& namespaces)
+{
+	for (const auto& item: namespaces) {
+		if (m_namespaceIndex.Insert(item, m_namespaces.size()) != m_namespaces.size()) continue;
+
+		Namespace newNamespace;
+		newNamespace.id = item;
+		newNamespace.name = Symbol(GetLastId(item.str()));
+		newNamespace.parentId = Symbol(GetWithoutLastId(item.str()));
+		m_namespaces.push_back(std::move(newNamespace));
+	}
+	SortById(m_namespaces, m_namespaceIndex);
+}
+
+void ClassManager::CalculateClasses(const std::vector<Class>& classes)
+{
+	// The entries are built in parallel, reading nothing but the indexes of the names. Which
+	// definition of a class is kept and the utility marks are then applied in input order.
+	const int count = static_cast<int>(classes.size());
+	std::vector<ClassEntry> entries(classes.size());
+	std::vector<std::vector<Symbol>> utilityClasses(classes.size());
+	#pragma omp parallel for schedule(dynamic, 64)
+	for (int i = 0; i < count; i++) {
+		BuildClassEntry(classes[i], entries[i], utilityClasses[i]);
+	}
+
+	m_classes.reserve(classes.size());
+	for (std::size_t i = 0; i < classes.size(); i++) {
+		// the first definition of a class wins
+		if (m_classIndex.Insert(classes[i].name, m_classes.size()) == m_classes.size()) {
+			m_classes.push_back(std::move(entries[i]));
+		}
+	}
+	std::vector<ClassEntry>().swap(entries);
+	SortById(m_classes, m_classIndex);
+
+	for (const auto& ids: utilityClasses) {
+		for (const auto& id: ids) {
+			if (ClassEntry* entry = FindClass(id)) {
+				entry->utility = true;
 			}
 		}
+	}
 
-		for (const auto& member: item.members) {
-			for (auto& connection: GetConnections(member.type, newEntry.namespaceId, ids, member.protectionLevel)) {
-				
-				// all classes directly (not as template parameter) as members are treated as utility classes
-				if (connection.type == DIRECT_INHERITANCE && member.type != newEntry.parentId) {
-					utilityClasses.push_back(member.type);
-				}
+	// Outermost class enclosing every class, none for a top level one. The id of the parent
+	// is a prefix of the id, so the parent is sorted before the class and done already.
+	const std::size_t NONE = SymbolIndex::NOT_FOUND;
+	std::vector<std::size_t> outermost(m_classes.size(), NONE);
+	for (std::size_t i = 0; i < m_classes.size(); i++) {
+		const std::size_t parent = m_classes[i].parentId.empty() ? NONE : m_classIndex.Find(m_classes[i].parentId);
+		if (parent != NONE) {
+			outermost[i] = outermost[parent] != NONE ? outermost[parent] : parent;
+		}
+	}
 
-				connection.type = MEMBER_ITEM;
-				connection.connectionCode += _T(" ");
-				connection.connectionCode += member.name;
-				connection.connectedMember = member.name;
-				newEntry.connections.push_back(connection);
+	// every class only gains connections of its own, from the entries of the others
+	const int classCount = static_cast<int>(m_classes.size());
+	#pragma omp parallel for schedule(dynamic, 64)
+	for (int i = 0; i < classCount; i++) {
+		ClassEntry& c = m_classes[i];
+		std::vector<ClassConnection> newConnections;
+		for (auto& connection: c.connections) {
+			if (connection.type != DIRECT_INHERITANCE) continue;
+
+			const std::size_t target = m_classIndex.Find(connection.targetId);
+			if (target == NONE || outermost[target] == NONE) continue;
+
+			const ClassEntry& parent = m_classes[outermost[target]];
+			if (!parent.utility && !parent.data.interface) {
+				ClassConnection indirectConnection = connection;
+				indirectConnection.type = INDIRECT_INHERITANCE;
+				indirectConnection.targetId = parent.id;
+				newConnections.push_back(std::move(indirectConnection));
 			}
 		}
+		c.connections.insert(c.connections.end(), newConnections.begin(), newConnections.end());
+	}
+}
 
-
-		m_classes.insert(std::map<string, ClassEntry>::value_type(item.name, std::move(newEntry)));
+void ClassManager::BuildClassEntry(const Class& item, ClassEntry& entry, std::vector<Symbol>& utilityClasses) const
+{
+	entry.id = item.name;
+	entry.name = Symbol(GetLastId(item.name.str()));
+	entry.data = item;
+
+	// The enclosing scopes are looked up as views of the name, from the innermost out.
+	// scopeSize gives the length of the scope around the first `size` characters, 0 at the top.
+	const string& name = item.name.str();
+	const auto scopeSize = [&name](std::size_t size) -> std::size_t {
+		const std::size_t found = size < 2 ? string::npos : name.rfind(_T("::"), size - 2);
+		return found == string::npos ? 0 : found;
+	};
+	std::size_t prefixSize = scopeSize(name.size());
+
+	// entry.parentId
+	if (prefixSize && !m_classNames.Find(stringRef(name.c_str(), prefixSize)).empty()) {
+		entry.parentId = Symbol(stringRef(name.c_str(), prefixSize));
+
+		// all member classes are treated as utility classes
+		entry.utility = true;
 	}
 
-	for (const auto& id: utilityClasses) {
-		if (m_classes.find(id) != m_classes.end()) {
-			m_classes[id].utility = true;
+	/*// all templated classes are treated as utility classes
+	if (item.templated)	{
+		entry.utility = true;
+	}*/
+
+	// entry.namespaceId
+	for (; prefixSize; prefixSize = scopeSize(prefixSize)) {
+		const stringRef prefix(name.c_str(), prefixSize);
+		const Symbol namespaceId = Symbol::Find(prefix);
+		if (m_classNames.Find(prefix).empty() &&
+			FindNamespace(namespaceId)) {
+				entry.namespaceId = namespaceId;
+				break;
 		}
 	}
 
-	for (auto& c: m_classes) {
-		std::vector<ClassConnection> newConnections;
-		for (auto& connection: c.second.connections) {
+	//entry.connections
+	for (const auto& parent: item.inheritance) {
+		for (auto& connection: GetConnections(parent.classId.str(), entry.namespaceId, parent.protLevel, parent.Virtual)) {
+			entry.connections.push_back(connection);
+
+			// all directly inherited classes are treated as utility classes
 			if (connection.type == DIRECT_INHERITANCE) {
-				string parentId;
-				{
-					string tmpCurClass = connection.targetId;
-					do {
-						const auto it = m_classes.find(tmpCurClass);
-						if (it != m_classes.end()) {
-							if (tmpCurClass != connection.targetId) {
-								parentId = tmpCurClass;
-							}
-							tmpCurClass = it->second.parentId;
-						}
-					} while(!tmpCurClass.empty());
-				}				
-
-				if (!parentId.empty() && !m_classes[parentId].utility && !m_classes[parentId].data.interface) {
-					ClassConnection indirectConnection = connection;
-					indirectConnection.type = INDIRECT_INHERITANCE;
-					indirectConnection.targetId = parentId;
-					newConnections.push_back(std::move(indirectConnection));
-				}
+				utilityClasses.push_back(connection.targetId);
 			}
 		}
-		c.second.connections.insert(c.second.connections.end(), newConnections.begin(), newConnections.end());
+	}
+
+	for (const auto& member: item.members) {
+		for (auto& connection: GetConnections(member.type.str(), entry.namespaceId, member.protectionLevel)) {
+			
+			// all classes directly (not as template parameter) as members are treated as utility classes
+			if (connection.type == DIRECT_INHERITANCE && member.type != entry.parentId) {
+				utilityClasses.push_back(member.type);
+			}
+
+			connection.type = MEMBER_ITEM;
+			connection.connectionCode += _T(" ");
+			connection.connectionCode += member.name.str();
+			connection.connectedMember = member.name;
+			entry.connections.push_back(connection);
+		}
 	}
 }
 
-std::vector<ClassManager::ClassConnection> ClassManager::GetConnections(const string& type, const string& namespaceId, const std::set<string>& ids, EProtectionLevel protLevel, bool Virtual) const
+std::vector<ClassManager::ClassConnection> ClassManager::GetConnections(const string& type, const stringRef& namespaceId, EProtectionLevel protLevel, bool Virtual) const
 {
 	std::vector<ClassConnection> result;
 	ClassConnection connection;
@@ -187,50 +368,24 @@ std::vector<ClassManager::ClassConnection> ClassManager::GetConnections(const st
 	connection.connectionCode += type;
 
 	const std::size_t templateDelimiter = type.find_first_of(_T('<'));
-	string directType = (templateDelimiter == string::npos) ? type : type.substr(0, templateDelimiter);
-	string indirectTypes = (templateDelimiter == string::npos) ? string() : type.substr(templateDelimiter + 1);
+	const stringRef directType(type.c_str(), (templateDelimiter == string::npos) ? type.size() : templateDelimiter);
+	const stringRef indirectTypes((templateDelimiter == string::npos) ? type.c_str() + type.size() : type.c_str() + templateDelimiter + 1,
+		(templateDelimiter == string::npos) ? 0 : type.size() - templateDelimiter - 1);
 
 	connection.type = DIRECT_INHERITANCE;
-	for (const auto& defItem: split(directType, _T(" \t&*"))) {
-		if (ids.find(defItem) != ids.end()) {
-			connection.targetId = defItem;
+	for (Tokens defItem(directType, TYPE_DELIMITERS); defItem.Next();) {
+		connection.targetId = m_classNames.Resolve(defItem.Current(), namespaceId);
+		if (!connection.targetId.empty()) {
 			result.push_back(connection);
-		} else {
-			string namespaceStr = namespaceId;
-			while(!namespaceStr.empty()) {
-				if (ids.find(namespaceStr + _T("::") + defItem) != ids.end()) {
-					connection.targetId = namespaceStr + _T("::") + defItem;
-					result.push_back(connection);
-					break;
-				}
-
-				const std::size_t pos = namespaceStr.rfind(_T("::"));
-				if (pos == string::npos) break;
-				namespaceStr = namespaceStr.substr(0, pos);
-			}
 		}
 	}
 
 	connection.type = INDIRECT_INHERITANCE;
-	for (const auto& defItem: split(indirectTypes, _T(",<> \t&*"))) {
-		if (ids.find(defItem) != ids.end()) {
-			connection.targetId = defItem;
+	for (Tokens defItem(indirectTypes, TEMPLATE_DELIMITERS); defItem.Next();) {
+		connection.targetId = m_classNames.Resolve(defItem.Current(), namespaceId);
+		if (!connection.targetId.empty()) {
 			result.push_back(connection);
-		} else {
-			string namespaceStr = namespaceId;
-			while(!namespaceStr.empty()) {
-				if (ids.find(namespaceStr + _T("::") + defItem) != ids.end()) {
-					connection.targetId = namespaceStr + _T("::") + defItem;
-					result.push_back(connection);
-					break;
-				}
-
-				const std::size_t pos = namespaceStr.rfind(_T("::"));
-				if (pos == string::npos) break;
-				namespaceStr = namespaceStr.substr(0, pos);
-			}
 		}
-
 	}
 
 	return result;
@@ -256,51 +411,63 @@ string ClassManager::GetWithoutLastId(const string& name)
 
 void ClassManager::ClearOrphanItems()
 {
-	bool erased;
-	do {
-		erased = false;
-		std::set<string> classesToBeCleared;
-		for (const auto& c: m_classes) {
-			classesToBeCleared.insert(c.first);
-		}
+	const std::size_t NONE = SymbolIndex::NOT_FOUND;
 
-		for (const auto& c: m_classes) {
-			classesToBeCleared.erase(c.second.parentId);
-			for (const auto& connection: c.second.connections) {		
-				classesToBeCleared.erase(connection.targetId);
-				classesToBeCleared.erase(c.first);
-			}
+	// A class is an orphan if it has no connections and neither a connection nor a nested
+	// class refers to it. Removing an orphan only releases its parent, which becomes an
+	// orphan in turn once nothing else refers to it.
+	std::vector<std::size_t> references(m_classes.size(), 0);
+	for (const auto& c: m_classes) {
+		const std::size_t parent = m_classIndex.Find(c.parentId);
+		if (parent != NONE) {
+			references[parent]++;
 		}
-		for (const auto& c: classesToBeCleared) {
-			erased = m_classes.erase(c) || erased;
+		for (const auto& connection: c.connections) {
+			const std::size_t target = m_classIndex.Find(connection.targetId);
+			if (target != NONE) {
+				references[target]++;
+			}
 		}
-	} while (erased);
-
+	}
 
-	do {
-		erased = false;
-		std::set<string> namespacesToBeCleared;
-		for (const auto& n: m_namespaces) {
-			namespacesToBeCleared.insert(n.first);
+	std::vector<std::size_t> orphans;
+	for (std::size_t i = 0; i < m_classes.size(); i++) {
+		if (m_classes[i].connections.empty() && references[i] == 0) {
+			orphans.push_back(i);
 		}
-		for (const auto& c: m_classes) {
-			namespacesToBeCleared.erase(c.second.namespaceId);
+	}
+	std::vector<bool> keepClass(m_classes.size(), true);
+	while (!orphans.empty()) {
+		const std::size_t orphan = orphans.back();
+		orphans.pop_back();
+		keepClass[orphan] = false;
+
+		const std::size_t parent = m_classIndex.Find(m_classes[orphan].parentId);
+		if (parent != NONE && --references[parent] == 0 && m_classes[parent].connections.empty()) {
+			orphans.push_back(parent);
 		}
+	}
+	EraseUnflagged(m_classes, m_classIndex, keepClass);
 
-		bool change;
-		do {
-			change = false;
-			for (const auto& n: m_namespaces) {
-				if (namespacesToBeCleared.find(n.first) == namespacesToBeCleared.end())	{
-					change = namespacesToBeCleared.erase(n.second.parentId) || change;
-				}
-			}
-		} while(change);
-
-		for (const auto& n: namespacesToBeCleared) {
-			erased = m_namespaces.erase(n) || erased;
+	// a namespace is kept if it, or a namespace nested in it, holds one of the classes left
+	std::vector<bool> keepNamespace(m_namespaces.size(), false);
+	std::vector<std::size_t> used;
+	for (const auto& c: m_classes) {
+		const std::size_t n = m_namespaceIndex.Find(c.namespaceId);
+		if (n != NONE && !keepNamespace[n]) {
+			keepNamespace[n] = true;
+			used.push_back(n);
+		}
+	}
+	while (!used.empty()) {
+		const std::size_t parent = m_namespaceIndex.Find(m_namespaces[used.back()].parentId);
+		used.pop_back();
+		if (parent != NONE && !keepNamespace[parent]) {
+			keepNamespace[parent] = true;
+			used.push_back(parent);
 		}
-	} while (erased);
+	}
+	EraseUnflagged(m_namespaces, m_namespaceIndex, keepNamespace);
 }
 
 string GetNamespaceFileName(const stringRef& namespaceId, bool external = true)
@@ -312,30 +479,30 @@ void ClassManager::WriteClassesJson()
 {
 	ClearOrphanItems();
 
-	JsonWriter file(m_outputDir + _T("\\classes.json"));
+	JsonWriter file(FileSystem::Combine(m_outputDir, _T("classes.json")));
 	for (const auto& n: m_namespaces) {
-		file.WriteNode(n.first, n.second.name, n.first, nullptr, _T("namespace"), n.second.parentId, GetNamespaceFileName(n.first));
+		file.WriteNode(n.id, n.name, n.id, nullptr, _T("namespace"), n.parentId, GetNamespaceFileName(n.id));
 	}
 	for (auto& c: m_classes) {
 
 		const _TCHAR* type = nullptr;
-		switch(c.second.data.type) {
+		switch(c.data.type) {
 		case Class::STRUCT: type = _T("struct"); break;
 		case Class::CLASS: type = _T("class"); break;
 		}
-		if (c.second.data.interface) {
-			c.second.utility = false; // interfaces are not utilities
+		if (c.data.interface) {
+			c.utility = false; // interfaces are not utilities
 			type = _T("interface");
 		}
 
 		// strip the utility classes
-		if (c.second.utility) continue;
+		if (c.utility) continue;
 
-		file.WriteNode(c.first, c.second.name, c.first, c.first, type, c.second.namespaceId, c.second.data.doxygenId, c.second.data.filename, c.second.data.description);			
+		file.WriteNode(c.id, c.name, c.id, c.id, type, c.namespaceId, c.data.doxygenId, c.data.filename, c.data.description);			
 	}
 
 	for (const auto& c: m_classes) {			
-		for (const auto& connection: c.second.connections) {
+		for (const auto& connection: c.connections) {
 
 			const _TCHAR* type = nullptr;
 			switch (connection.type)
@@ -355,11 +522,11 @@ void ClassManager::WriteClassesJson()
 			}
 			classes.push_back(GetProtectionLevel(connection.protectionLevel));
 
-			file.WriteEdge(c.first, connection.targetId, type, connection.connectionCode, classes);
+			file.WriteEdge(c.id, connection.targetId, type, connection.connectionCode, classes);
 		}
 
-		if (!c.second.parentId.empty()) {
-			file.WriteEdge(c.first, c.second.parentId, _T("parent"));
+		if (!c.parentId.empty()) {
+			file.WriteEdge(c.id, c.parentId, _T("parent"));
 		}
 	}
 
@@ -369,48 +536,52 @@ void ClassManager::WriteClassesJson()
 void ClassManager::CalculateMethods()
 {
 	for (auto& c: m_classes) {
-		const std::map<string, string> usableClasses = GetUsableClasses(c.first, c.second.namespaceId);
-		for (auto& method: c.second.data.methods) {
-			// Get Other types usages in return values & parameters
-			for (const auto& usable: usableClasses) {
-				const std::basic_regex<_TCHAR> regex((string(_T("(^|.*[^\\w])")) + usable.first + _T("($|[^\\w:].*)")).c_str());
-				if (std::regex_match(method.returnType, regex)) {
-					MemberUsage usage;
-					usage.sourceMethodId = method.doxygenId;
-					usage.connectionCode = string(_T("return type: ") + method.returnType);
-					usage.targetId = usable.second;
-					usage.type = CLASS_USAGE;
-					c.second.memberUsages.push_back(std::move(usage));
-					if (method.protectionLevel != PRIVATE) {
-						m_classes[usable.second].utility = true;
-					}
+		const std::map<string, Symbol> usableClasses = GetUsableClasses(c.id, c.namespaceId);
+		const TypeMatcher matcher(usableClasses);
+		std::vector<std::size_t> found;
+		for (auto& method: c.data.methods) {
+			// Get Other types usages in return values & parameters, by usable class, then the
+			// return type before the parameters
+			std::vector<std::pair<std::size_t, std::size_t>> matches; // usable index, 0 or parameter + 1
+			matcher.Match(method.returnType, found);
+			for (const auto index: found) {
+				matches.push_back(std::make_pair(index, static_cast<std::size_t>(0)));
+			}
+			for (std::size_t i = 0; i < method.params.size(); i++) {
+				matcher.Match(method.params[i].type, found);
+				for (const auto index: found) {
+					matches.push_back(std::make_pair(index, i + 1));
 				}
+			}
+			std::sort(matches.begin(), matches.end());
 
-				for (const auto& param: method.params) {
-					if (std::regex_match(param.type, regex)) {
-						MemberUsage usage;
-						usage.sourceMethodId = method.doxygenId;
-						usage.connectionCode = string(_T("param: ") + param.type + _T(" ") + param.name);
-						usage.targetId = usable.second;
-						usage.type = CLASS_USAGE;
-						c.second.memberUsages.push_back(std::move(usage));
-						if (method.protectionLevel != PRIVATE) {
-							m_classes[usable.second].utility = true;
-						}
-					}
+			for (const auto& match: matches) {
+				MemberUsage usage;
+				usage.sourceMethodId = method.doxygenId;
+				if (match.second == 0) {
+					usage.connectionCode = string(_T("return type: ") + method.returnType.str());
+				} else {
+					const Method::Param& param = method.params[match.second - 1];
+					usage.connectionCode = string(_T("param: ") + param.type.str() + _T(" ") + param.name.str());
+				}
+				usage.targetId = matcher.Target(match.first);
+				usage.type = CLASS_USAGE;
+				c.memberUsages.push_back(std::move(usage));
+				if (method.protectionLevel != PRIVATE) {
+					GetClass(matcher.Target(match.first)).utility = true;
 				}
 			}
-			
+
 
 			// Get overrides
 			if (!method.Virtual) continue;
 
 			std::vector<ClassConnection> connections;
-			for (auto& connection: c.second.connections) {
+			for (auto& connection: c.connections) {
 				if (connection.type != DIRECT_INHERITANCE) continue;
 				connections.push_back(connection);
 			}
-			for (auto& connection: c.second.connections) {
+			for (auto& connection: c.connections) {
 				if (connection.type != INDIRECT_INHERITANCE) continue;
 				connections.push_back(connection);
 			}
@@ -418,14 +589,14 @@ void ClassManager::CalculateMethods()
 			bool found = false;
 			for (auto& connection: connections) {
 				if (found) break;
-				const auto it = m_classes.find(connection.targetId);
-				if (it == m_classes.end()) continue;
+				const ClassEntry* target = FindClass(connection.targetId);
+				if (!target) continue;
 
-				for (auto& targetMethod: it->second.data.methods) {
+				for (auto& targetMethod: target->data.methods) {
 					if (!targetMethod.Virtual) continue;
 
 					if (targetMethod.name == method.name && targetMethod.Const == method.Const && targetMethod.params.size() == method.params.size()) {
-						c.second.methodOverrides.insert(std::map<string, string>::value_type(method.doxygenId, it->first));
+						c.methodOverrides.insert(std::map<Symbol, Symbol>::value_type(method.doxygenId, target->id));
 						found = true;
 						break;
 					}
@@ -434,50 +605,55 @@ void ClassManager::CalculateMethods()
 		}
 
 		// Find utility classes used as members of other classes
-		for (auto& member: c.second.data.members) {
-			for (const auto& usable: usableClasses) {
-				const std::basic_regex<_TCHAR> regex((string(_T("(^|.*[^\\w])")) + usable.first + _T("($|[^\\w:].*)")).c_str());
-				if (std::regex_match(member.type, regex) && usable.second != c.second.parentId) {
-					m_classes[usable.second].utility = true;
+		for (auto& member: c.data.members) {
+			matcher.Match(member.type, found);
+			for (const auto index: found) {
+				if (matcher.Target(index) != c.parentId) {
+					GetClass(matcher.Target(index)).utility = true;
 				}
 			}
 		}
 	}
 }
 
-void ClassManager::ProcessDef(const Element& classDef)
+void ClassManager::AddDefinitions(Definitions&& definitions)
 {
-	const stringRef kind = classDef.GetAttribute(_T("kind"));
+	for (auto& item: definitions.classes) {
+		tcout << _T("New class: ") << item.name.str() << std::endl;
+		initClasses.push_back(std::move(item));
+	}
+	for (auto& item: definitions.namespaces) {
+		initNamespaces.push_back(std::move(item));
+	}
+}
+
+void ClassManager::ProcessDef(const Element& classDef, Definitions& definitions)
+{
+	const EKeyword kind = DecodeKeyword(classDef.GetAttribute(_T("kind")));
+
+	switch (kind) {
+	case KW_NAMESPACE:
+		definitions.namespaces.push_back(Symbol(classDef.GetElement(_T("compoundname")).Text()));
+		break;
 
-	if (kind == _T("namespace")) {
-		initNamespaces.push_back(string(classDef.GetElement(_T("compoundname")).Text().str()));
-	} else if (kind == _T("class") || kind == _T("struct")) {
+	case KW_CLASS:
+	case KW_STRUCT: {
 		Class newClass;
-		newClass.doxygenId = classDef.GetAttribute(_T("id")).str();
-		newClass.type = kind == _T("class") ? Class::CLASS : Class::STRUCT;
+		newClass.doxygenId = Symbol(classDef.GetAttribute(_T("id")));
+		newClass.type = kind == KW_CLASS ? Class::CLASS : Class::STRUCT;
 
-		newClass.name = classDef.GetElement(_T("compoundname")).Text().str();
-		std::wcout << _T("New class: ") << newClass.name << std::endl;
+		newClass.name = Symbol(classDef.GetElement(_T("compoundname")).Text());
 
-		newClass.filename = classDef.GetElement(_T("location")).GetAttribute(_T("file")).str();
+		newClass.filename = Symbol(classDef.GetElement(_T("location")).GetAttribute(_T("file")));
 		newClass.templated = classDef.GetElement(_T("templateparamlist"));
 		newClass.description = trim(classDef.GetElement(_T("briefdescription")).Text().str());
+		const bool abstract = DecodeKeyword(classDef.GetAttribute(_T("abstract"))) == KW_YES;
 
 		for (const auto& parent : classDef.Elements(_T("basecompoundref"))) {
 			Inheritance inheritance;
-			inheritance.classId = parent.Text().str();
-
-			inheritance.protLevel = PACKAGE;
-			stringRef prot = parent.GetAttribute(_T("prot"));
-			if (prot == _T("public")) {
-				inheritance.protLevel = PUBLIC;
-			} else if (prot == _T("protected")) {
-				inheritance.protLevel = PROTECTED;
-			} else if (prot == _T("private")) {
-				inheritance.protLevel = PRIVATE;
-			}
-
-			inheritance.Virtual = (parent.GetAttribute(_T("virt")) == _T("virtual"));
+			inheritance.classId = Symbol(parent.Text());
+			inheritance.protLevel = ParseProtectionLevel(parent.GetAttribute(_T("prot")));
+			inheritance.Virtual = DecodeKeyword(parent.GetAttribute(_T("virt"))) == KW_VIRTUAL;
 
 			newClass.inheritance.push_back(std::move(inheritance));
 		}
@@ -485,231 +661,434 @@ void ClassManager::ProcessDef(const Element& classDef)
 
 		for (const auto& section : classDef.Elements(_T("sectiondef"))) {
 			for (const auto& member : section.Elements(_T("memberdef"))) {
-				EProtectionLevel protectionLevel = PACKAGE;
-				const stringRef prot = member.GetAttribute(_T("prot"));
-
-				if (prot == _T("public")) {
-					protectionLevel = PUBLIC;
-				} else if (prot == _T("protected")) {
-					protectionLevel = PROTECTED;
-				} else if (prot == _T("private")) {
-					protectionLevel = PRIVATE;
-				}
+				const EProtectionLevel protectionLevel = ParseProtectionLevel(member.GetAttribute(_T("prot")));
 
-
-				const stringRef kind = member.GetAttribute(_T("kind"));
-				if (kind == _T("function")) {
+				switch (DecodeKeyword(member.GetAttribute(_T("kind")))) {
+				case KW_FUNCTION: {
 					Method method;
-					method.name = member.GetElement(_T("name")).Text().str();
-					method.doxygenId = member.GetAttribute(_T("id")).str();
+					method.name = Symbol(member.GetElement(_T("name")).Text());
+					method.doxygenId = Symbol(member.GetAttribute(_T("id")));
 					method.description = trim(member.GetElement(_T("briefdescription")).Text().str());
 					method.protectionLevel = protectionLevel;
-					method.returnType = member.GetElement(_T("type")).Text().str();
-					method.Const = member.GetAttribute(_T("const")) == _T("yes");
-					method.Virtual = member.GetAttribute(_T("virt")) != _T("non-virtual");
+					method.returnType = Symbol(member.GetElement(_T("type")).Text());
+					method.Const = DecodeKeyword(member.GetAttribute(_T("const"))) == KW_YES;
+					method.Virtual = DecodeKeyword(member.GetAttribute(_T("virt"))) != KW_NON_VIRTUAL;
 					method.Override = (string(member.GetAttribute(_T("argsstring")).str()).find(_T("override")) != string::npos);
 					for (const auto& param : member.Elements(_T("param"))) {
 						Method::Param p;
-						p.name = param.GetElement(_T("declname")).Text().str();
-						p.type = param.GetElement(_T("type")).Text().str();
+						p.name = Symbol(param.GetElement(_T("declname")).Text());
+						p.type = Symbol(param.GetElement(_T("type")).Text());
 						method.params.push_back(std::move(p));
 					}
 					const Element location = member.GetElement(_T("location"));
-					method.locationFile = location.GetAttribute(_T("bodyfile")).str();
+					method.locationFile = Symbol(location.GetAttribute(_T("bodyfile")));
 					method.bodyBeginLine = location.GetAttribute(_T("bodystart")).str();
 					method.bodyEndLine = location.GetAttribute(_T("bodyend")).str();
 
-					if (!newClass.interface && method.Virtual && method.protectionLevel == PUBLIC && classDef.GetAttribute(_T("abstract")) == _T("yes")) {
+					if (!newClass.interface && method.Virtual && method.protectionLevel == PUBLIC && abstract) {
 						newClass.interface = true;
 					}
 
 					newClass.methods.push_back(std::move(method));
-				} else if (kind == _T("variable")) {
+					break;
+				}
+
+				case KW_VARIABLE: {
 					Member m;
 					m.protectionLevel = protectionLevel;
-					m.name = member.GetElement(_T("name")).Text().str();
-					m.type = member.GetElement(_T("type")).Text().str();
+					m.name = Symbol(member.GetElement(_T("name")).Text());
+					m.type = Symbol(member.GetElement(_T("type")).Text());
 					m.description = trim(member.GetElement(_T("briefdescription")).Text().str());
-					newClass.members.push_back(std::move(m));}
+					newClass.members.push_back(std::move(m));
+					break;
+				}
+
+				default:
+					break;
+				}
 			}
 		}
 
-		initClasses.push_back(std::move(newClass));
+		definitions.classes.push_back(std::move(newClass));
+		break;
+	}
+
+	default:
+		break;
 	}
 }
 
-std::map<string, string> ClassManager::GetUsableClasses(const stringRef& classId, const stringRef& namespaceId) const
+std::map<string, Symbol> ClassManager::GetUsableClasses(const Symbol& classId, const Symbol& namespaceId) const
 {
-	std::map<string, string> usableClasses; // search string -> class id
+	std::map<string, Symbol> usableClasses; // search string -> class id
 	for (auto& cl: m_classes) {
-		if (cl.first == classId.str()) continue;
-		if (cl.second.namespaceId == namespaceId.str()) {
-			usableClasses.insert(std::map<string, string>::value_type(cl.second.name, cl.first));
+		if (classId == cl.id) continue;
+		if (namespaceId == cl.namespaceId) {
+			usableClasses.insert(std::map<string, Symbol>::value_type(cl.name.str(), cl.id));
 		} else {
-			string otherId = cl.first;
-			for (const auto& part: split(classId.str(), _T("::"))) {
-				if (otherId.substr(0, part.size() + 2) == (part + _T("::"))) {
-					otherId = otherId.substr(part.size() + 2);
+			// strip the leading parts shared with the class id
+			const string& otherId = cl.id.str();
+			std::size_t start = 0;
+			for (Tokens part(classId, ID_DELIMITERS); part.Next();) {
+				const stringRef prefix = part.Current();
+				if (otherId.size() - start >= prefix.size() + 2 && otherId.compare(start, prefix.size(), prefix.str(), prefix.size()) == 0 &&
+					otherId[start + prefix.size()] == _T(':') && otherId[start + prefix.size() + 1] == _T(':')) {
+					start += prefix.size() + 2;
 				} else break;
 			}
-			usableClasses.insert(std::map<string, string>::value_type(otherId, cl.first));
+			usableClasses.insert(std::map<string, Symbol>::value_type(otherId.substr(start), cl.id));
 		}
 	}
 
 	return usableClasses;
 }
 
-void ClassManager::ProcessFileDef(const Element& fileDef)
+// Scan state of the classes and methods in the file. The methods are listed in class and
+// method order, which is the order their usages are handed out in.
+struct ClassManager::FileScanner::State {
+	struct ClassScan {
+		const Symbol* id;
+		const ClassEntry* entry;
+		bool prepared; //!< the patterns are compiled, once a method of the class starts
+
+		std::map<string, Symbol> usableClasses; //!< search string -> class id
+		std::vector<std::basic_regex<_TCHAR>> memberRegexes, methodRegexes, usableRegexes;
+	};
+
+	struct MethodScan {
+		std::size_t classIndex;
+		const Method* method;
+		bool firstLine;
+		std::vector<MemberUsage> usages;
+	};
+
+	State(const ClassManager& manager) : manager(manager) {}
+
+	void Prepare(ClassScan& scan);
+	void Scan(MethodScan& scan, const string& text);
+
+	const ClassManager& manager;
+	string location;
+	std::vector<ClassScan> classes;
+	std::vector<MethodScan> methods;
+	std::unordered_map<stringRef, std::vector<std::size_t>> starts; //!< body start line -> methods waiting for it
+	std::vector<std::size_t> active; //!< methods the lines are in the body of
+	string lineText, text, methodText; // line buffers reused for every line
+	string connectionCode;
+};
+
+void ClassManager::FileScanner::State::Prepare(ClassScan& scan)
 {
-	const stringRef location = fileDef.GetElement(_T("location")).GetAttribute(_T("file")).str();
-	for (auto& c: m_classes) {
+	if (scan.prepared) return;
+	scan.prepared = true;
 
-		 // search string -> class id
-		const std::map<string, string> usableClasses = GetUsableClasses(c.first, c.second.namespaceId);
+	const ClassEntry& c = *scan.entry;
+	scan.usableClasses = manager.GetUsableClasses(*scan.id, c.namespaceId);
 
-		for (const auto& method: c.second.data.methods) {
-			if (method.locationFile != location.str()) continue;
+	// the patterns only depend on the class, compile them once instead of for every line
+	for (const auto& member: c.data.members) {
+		scan.memberRegexes.push_back(std::basic_regex<_TCHAR>((string(_T(".*[^\\.>]\\s*(\\s|[^\\w\\.>])")) + member.name.str() + _T("[^\\w].*")).c_str()));
+	}
+	for (const auto& m: c.data.methods) {
+		scan.methodRegexes.push_back(std::basic_regex<_TCHAR>((string(_T(".*[^\\.>]\\s*(\\s|[^\\w\\.>])")) + m.name.str() + _T("\\s*\\(.*")).c_str()));
+	}
+	for (const auto& usable: scan.usableClasses) {
+		scan.usableRegexes.push_back(std::basic_regex<_TCHAR>((string(_T(".*[^\\.>]\\s*(\\s|[^\\w\\.>])")) + usable.first + _T("[^\\w:].*")).c_str()));
+	}
+}
 
-			bool started = false;
-			for (const auto& line: fileDef.GetElement(_T("programlisting")).Elements(_T("codeline"))) {
-				const stringRef lineNo = line.GetAttribute(_T("lineno"));
-				bool firstLine = false;
-				if (!started) {
-					started = (method.bodyBeginLine == lineNo.str());
-					if (!started) continue;
-					firstLine = true;
+void ClassManager::FileScanner::State::Scan(MethodScan& scan, const string& text)
+{
+	const ClassScan& classScan = classes[scan.classIndex];
+	const ClassEntry& c = *classScan.entry;
+	const Method& method = *scan.method;
+
+	MemberUsage usage;
+	usage.sourceMethodId = method.doxygenId;
+	usage.connectionCode = connectionCode;
+
+	// members
+	for (std::size_t i = 0; i < c.data.members.size(); i++) {
+		const auto& member = c.data.members[i];
+		if (std::regex_match(text, classScan.memberRegexes[i])) {
+			usage.targetId = member.name;
+			usage.type = MEMBER_ACCESS;
+			scan.usages.push_back(usage);
+		}
+	}
+
+	// methods
+	for (std::size_t i = 0; i < c.data.methods.size(); i++) {
+		const auto& m = c.data.methods[i];
+		if (method.Const && !m.Const) continue;
+
+		if (std::regex_match(text, classScan.methodRegexes[i])) {
+			usage.targetId = m.doxygenId;
+			usage.type = METHOD_CALL;
+			for (const auto& o: c.data.methods) {
+				if (o != m && o.name == m.name) {
+					usage.certain = false;
+					break;
 				}
+			}
+			scan.usages.push_back(usage);
+		}
+	}
 
-				MemberUsage usage;
-				usage.sourceMethodId = method.doxygenId;
-				usage.connectionCode = string(location.str()) + _T("(") + lineNo.str() + _T("):\n") + trim(line.Text().str());
+	// other classes usages
+	auto usableRegex = classScan.usableRegexes.begin();
+	for (const auto& usable: classScan.usableClasses) {
+		if (std::regex_match(text, *usableRegex++)) {
+			usage.targetId = usable.second;
+			usage.type = CLASS_USAGE;
+			scan.usages.push_back(usage);
+		}
+	}
+}
 
-				// remove all comments
-				string text;
-				for (const auto& item: line.Elements(_T("highlight"))) {
-					if (item.GetAttribute(_T("class")) != _T("comment")) {
-						text += item.Text().str();
-					}
-				}
+ClassManager::FileScanner::FileScanner(const ClassManager& manager, const stringRef& location) : m_state(new State(manager))
+{
+	State& state = *m_state;
+	state.location = location.str();
+
+	const Symbol locationFile = Symbol::Find(location); // no method is in a file that is not interned
+	if (location && locationFile.empty()) return;
+
+	for (const auto& c: manager.m_classes) {
+		const std::size_t classIndex = state.classes.size();
+		for (const auto& method: c.data.methods) {
+			if (locationFile != method.locationFile) continue;
+
+			if (state.classes.size() == classIndex) {
+				State::ClassScan scan;
+				scan.id = &c.id;
+				scan.entry = &c;
+				scan.prepared = false;
+				state.classes.push_back(std::move(scan));
+			}
 
-				// remove string literal constants
-				while(true) {
-					const std::size_t startPosition = text.find(_T('\"'));
-					if (startPosition == string::npos) break;
-
-					std::size_t endPosition = startPosition;
-					do {
-						endPosition = text.find(_T('\"'), endPosition + 1);
-					} while(endPosition != string::npos && text[endPosition-1] == _T('\\'));
-					if (endPosition == string::npos) break;
-					text.erase(startPosition, endPosition - startPosition + 1);
-				}
+			State::MethodScan scan;
+			scan.classIndex = classIndex;
+			scan.method = &method;
+			scan.firstLine = false;
+			state.starts[stringRef(method.bodyBeginLine.c_str(), method.bodyBeginLine.size())].push_back(state.methods.size());
+			state.methods.push_back(std::move(scan));
+		}
+	}
+}
 
-				// start from { if on first line
-				if (firstLine) {
-					const std::size_t startPosition = text.find(_T('{'));
-					if (startPosition != string::npos) {
-						text.erase(0, startPosition);
-					} else {
-						text.clear();
-					}
-				}
+ClassManager::FileScanner::~FileScanner()
+{
+}
 
+void ClassManager::FileScanner::AddLine(const Element& codeline)
+{
+	State& state = *m_state;
+	const stringRef lineNo = codeline.GetAttribute(_T("lineno"));
+
+	const auto starting = state.starts.find(lineNo);
+	if (starting != state.starts.end()) {
+		for (std::size_t index: starting->second) {
+			state.methods[index].firstLine = true;
+			state.Prepare(state.classes[state.methods[index].classIndex]);
+			state.active.push_back(index);
+		}
+		state.starts.erase(starting);
+	}
+	if (state.active.empty()) return;
+
+	state.lineText.clear();
+	codeline.AppendText(state.lineText);
+	state.connectionCode = state.location + _T("(") + lineNo.str() + _T("):\n") + trim(state.lineText);
+
+	// remove all comments
+	string& text = state.text;
+	text.clear();
+	for (const auto& item: codeline.Elements(_T("highlight"))) {
+		if (DecodeKeyword(item.GetAttribute(_T("class"))) != KW_COMMENT) {
+			item.AppendText(text);
+		}
+	}
 
-				// members
-				for (const auto& member: c.second.data.members) {
-					const std::basic_regex<_TCHAR> regex((string(_T(".*[^\\.>]\\s*(\\s|[^\\w\\.>])")) + member.name + _T("[^\\w].*")).c_str());
-					if (std::regex_match(text, regex)) {
-						usage.targetId = member.name;
-						usage.type = MEMBER_ACCESS;
-						std::lock_guard<std::mutex> guard(m_lock);
-						c.second.memberUsages.push_back(usage);
-					}
-				}
+	// remove string literal constants
+	while(true) {
+		const std::size_t startPosition = text.find(_T('\"'));
+		if (startPosition == string::npos) break;
 
-				// methods
-				for (const auto& m: c.second.data.methods) {
-					if (method.Const && !m.Const) continue;
-
-					const std::basic_regex<_TCHAR> regex((string(_T(".*[^\\.>]\\s*(\\s|[^\\w\\.>])")) + m.name + _T("\\s*\\(.*")).c_str());
-					if (std::regex_match(text, regex)) {
-						usage.targetId = m.doxygenId;
-						usage.type = METHOD_CALL;
-						for (const auto& o: c.second.data.methods) {
-							if (o != m && o.name == m.name) {
-								usage.certain = false;
-								break;
-							}
-						}
-						std::lock_guard<std::mutex> guard(m_lock);
-						c.second.memberUsages.push_back(usage);
-					}
-				}
+		std::size_t endPosition = startPosition;
+		do {
+			endPosition = text.find(_T('\"'), endPosition + 1);
+		} while(endPosition != string::npos && text[endPosition-1] == _T('\\'));
+		if (endPosition == string::npos) break;
+		text.erase(startPosition, endPosition - startPosition + 1);
+	}
 
-				// other classes usages
-				for (const auto& usable: usableClasses) {
-					const std::basic_regex<_TCHAR> regex((string(_T(".*[^\\.>]\\s*(\\s|[^\\w\\.>])")) + usable.first + _T("[^\\w:].*")).c_str());
-					if (std::regex_match(text, regex)) {
-						usage.targetId = usable.second;
-						usage.type = CLASS_USAGE;
-						std::lock_guard<std::mutex> guard(m_lock);
-						c.second.memberUsages.push_back(usage);
-					}
-				}
+	for (std::size_t index: state.active) {
+		State::MethodScan& scan = state.methods[index];
+		if (scan.firstLine) {
+			scan.firstLine = false;
+
+			// start from { if on first line
+			const std::size_t startPosition = text.find(_T('{'));
+			if (startPosition != string::npos) {
+				state.methodText.assign(text, startPosition, string::npos);
+			} else {
+				state.methodText.clear();
+			}
+			state.Scan(scan, state.methodText);
+		} else {
+			state.Scan(scan, text);
+		}
+	}
+
+	// the methods ending on this line
+	state.active.erase(std::remove_if(state.active.begin(), state.active.end(), [&](std::size_t index) {
+		return lineNo == state.methods[index].method->bodyEndLine;
+	}), state.active.end());
+}
 
-				if (method.bodyEndLine == lineNo.str()) break;
+void ClassManager::FileScanner::Finish(Usages& usages)
+{
+	State& state = *m_state;
+	for (auto& scan: state.methods) {
+		const Symbol& classId = *state.classes[scan.classIndex].id;
+		for (auto& usage: scan.usages) {
+			usages.push_back(std::make_pair(classId, std::move(usage)));
+		}
+		scan.usages.clear();
+	}
+}
+
+void ClassManager::ProcessFileDef(const Element& fileDef, Usages& usages) const
+{
+	FileScanner scanner(*this, fileDef.GetElement(_T("location")).GetAttribute(_T("file")));
+	for (const auto& line: fileDef.GetElement(_T("programlisting")).Elements(_T("codeline"))) {
+		scanner.AddLine(line);
+	}
+	scanner.Finish(usages);
+}
+
+namespace {
+	// the values of a description are written with their sizes, so that it is unambiguous
+	void Describe(std::string& out, std::size_t value)
+	{
+		const unsigned size = static_cast<unsigned>(value);
+		out.append(reinterpret_cast<const char*>(&size), sizeof(size));
+	}
+
+	void Describe(std::string& out, const string& value)
+	{
+		Describe(out, value.size());
+		out.append(reinterpret_cast<const char*>(value.data()), value.size() * sizeof(_TCHAR));
+	}
+}
+
+void ClassManager::DescribeClassNames(std::string& out) const
+{
+	Describe(out, m_classes.size());
+	for (const auto& c: m_classes) {
+		Describe(out, c.id.str());
+		Describe(out, c.name.str());
+		Describe(out, c.namespaceId.str());
+	}
+}
+
+void ClassManager::DescribeFileModel(const std::vector<string>& locations, std::string& out) const
+{
+	// the same selection of classes and methods as the FileScanner makes
+	Describe(out, locations.size());
+	for (const auto& location: locations) {
+		Describe(out, location);
+		const Symbol locationFile = Symbol::Find(location);
+		if (!location.empty() && locationFile.empty()) {
+			out.push_back(0);
+			continue;
+		}
+
+		for (const auto& c: m_classes) {
+			const bool scanned = std::any_of(c.data.methods.begin(), c.data.methods.end(), [&locationFile](const Method& method) {
+				return method.locationFile == locationFile;
+			});
+			if (!scanned) continue;
+
+			out.push_back(1); // a class follows
+			Describe(out, c.id.str());
+			Describe(out, c.namespaceId.str());
+			Describe(out, c.data.members.size());
+			for (const auto& member: c.data.members) {
+				Describe(out, member.name.str());
+			}
+			Describe(out, c.data.methods.size());
+			for (const auto& method: c.data.methods) {
+				Describe(out, method.name.str());
+				Describe(out, method.doxygenId.str());
+				const bool located = method.locationFile == locationFile;
+				out.push_back(static_cast<char>((method.Const ? 1 : 0) | (located ? 2 : 0)));
+				if (located) {
+					Describe(out, method.bodyBeginLine);
+					Describe(out, method.bodyEndLine);
+				}
 			}
 		}
+		out.push_back(0);
+	}
+}
+
+void ClassManager::AddUsages(Usages&& usages)
+{
+	for (auto& item: usages) {
+		GetClass(item.first).memberUsages.push_back(std::move(item.second));
 	}
 }
 
 void ClassManager::WriteSingleClassJsons() const
 {
 	for (const auto& c: m_classes) {
-		WriteSingleClassJson(c.first);
+		WriteSingleClassJson(c.id);
 	}
 }
 
 void ClassManager::WriteNamespaceJsons() const
 {
 	for (const auto& n: m_namespaces) {
-		WriteNamespaceJson(n.first, true);
-		WriteNamespaceJson(n.first, false);
+		WriteNamespaceJson(n.id, true);
+		WriteNamespaceJson(n.id, false);
 	}
 }
 
-void ClassManager::WriteSingleClassJson(const stringRef& id) const
+void ClassManager::WriteSingleClassJson(const Symbol& id) const
 {
-	const auto& c = m_classes.at(id.str());
-	JsonWriter file(m_outputDir + _T("\\") + c.data.doxygenId + _T(".json"), id);
+	const auto& c = GetClass(id);
+	JsonWriter file(FileSystem::Combine(m_outputDir, c.data.doxygenId.str() + _T(".json")), id);
+	const Symbol classNode(_T("class"));
 
-	std::set<string> collaborators;
-	file.WriteNode(_T("class"), id, id, nullptr, _T("object"), nullptr, nullptr, c.data.filename);
+	std::set<Symbol> collaborators;
+	file.WriteNode(classNode, id, id, nullptr, _T("object"), Symbol(), nullptr, c.data.filename);
 	if (!c.parentId.empty()) {
-		file.WriteNode(c.parentId, m_classes.at(c.parentId).name, c.parentId, c.parentId, _T("parent"), nullptr, m_classes.at(c.parentId).data.doxygenId, m_classes.at(c.parentId).data.filename, m_classes.at(c.parentId).data.description);
+		file.WriteNode(c.parentId, GetClass(c.parentId).name, c.parentId, c.parentId, _T("parent"), Symbol(), GetClass(c.parentId).data.doxygenId, GetClass(c.parentId).data.filename, GetClass(c.parentId).data.description);
 	}
 	for (const auto& connection: c.connections) {
 		const _TCHAR* type = nullptr;
-		switch(m_classes.at(connection.targetId).data.type) {
+		switch(GetClass(connection.targetId).data.type) {
 		case Class::CLASS: type = _T("class"); break;
 		case Class::STRUCT: type = _T("struct"); break;
 		}
-		if (m_classes.at(connection.targetId).data.interface) {
+		if (GetClass(connection.targetId).data.interface) {
 			type = _T("interface");
 		}
 
 		std::vector<string> classes;
-		if (m_classes.at(connection.targetId).utility) {
+		if (GetClass(connection.targetId).utility) {
 			classes.push_back(_T("utility"));
 		}
-		file.WriteNode(connection.targetId, m_classes.at(connection.targetId).name, connection.targetId, connection.targetId, type, nullptr, m_classes.at(connection.targetId).data.doxygenId, m_classes.at(connection.targetId).data.filename, m_classes.at(connection.targetId).data.description, classes);
+		file.WriteNode(connection.targetId, GetClass(connection.targetId).name, connection.targetId, connection.targetId, type, Symbol(), GetClass(connection.targetId).data.doxygenId, GetClass(connection.targetId).data.filename, GetClass(connection.targetId).data.description, classes);
 	}
 	for (const auto& method: c.data.methods) {
 		std::basic_ostringstream<_TCHAR> hoverName; 
 		hoverName << GetProtectionLevel(method.protectionLevel) << _T(" ")
 			<< (method.Virtual ? _T("virtual ") : _T(""))
-			<< (method.returnType.empty() ? _T("") : method.returnType + _T(" "))
-			<< method.name << _T("(");
+			<< (method.returnType.empty() ? _T("") : method.returnType.str() + _T(" "))
+			<< method.name.str() << _T("(");
 		{
 			bool firstParam = true;
 			for (const auto& param: method.params) {
@@ -717,7 +1096,7 @@ void ClassManager::WriteSingleClassJson(const stringRef& id) const
 					hoverName << _T(", ");
 				}
 				firstParam = false;
-				hoverName << param.type << _T(" ") << param.name;
+				hoverName << param.type.str() << _T(" ") << param.name.str();
 			}
 		}
 		hoverName << _T(")");
@@ -728,9 +1107,9 @@ void ClassManager::WriteSingleClassJson(const stringRef& id) const
 		classes.push_back(GetProtectionLevel(method.protectionLevel));
 		if (method.name == c.name) {
 			classes.push_back(_T("constructor"));
-		} else if (method.name[0] == _T('~')) {
+		} else if (method.name.str()[0] == _T('~')) {
 			classes.push_back(_T("destructor"));
-		} else if (method.name.find(_T("operator")) != string::npos) {
+		} else if (method.name.str().find(_T("operator")) != string::npos) {
 			classes.push_back(_T("operator"));
 		}
 		if (method.Const) {
@@ -743,54 +1122,54 @@ void ClassManager::WriteSingleClassJson(const stringRef& id) const
 			classes.push_back(_T("override"));
 		}
 
-		file.WriteNode(method.doxygenId, method.name, method.name, hoverName.str(), _T("method"), _T("class"), nullptr, nullptr, method.description, classes);
+		file.WriteNode(method.doxygenId, method.name, method.name, hoverName.str(), _T("method"), classNode, nullptr, nullptr, method.description, classes);
 	}
 	for (const auto& member: c.data.members) {
 		std::basic_ostringstream<_TCHAR> longName;
 		longName << GetProtectionLevel(member.protectionLevel) << _T(" ")
-			<< member.type << _T(" ") << member.name;
+			<< member.type.str() << _T(" ") << member.name.str();
 
 		std::vector<string> classes;
 		classes.push_back(GetProtectionLevel(member.protectionLevel));
-		file.WriteNode(member.name, member.name, member.name, longName.str(), _T("member"), _T("class"), nullptr, nullptr, member.description, classes);
+		file.WriteNode(member.name, member.name, member.name, longName.str(), _T("member"), classNode, nullptr, nullptr, member.description, classes);
 	}
 
 	// connections from other classes
 	for (const auto& other: m_classes) {
-		if (other.second.parentId == id.str()) {
-			collaborators.insert(other.first);
+		if (id == other.parentId) {
+			collaborators.insert(other.id);
 		}
-		for (const auto& connection: other.second.connections) {
-			if (connection.targetId == id.str())	{
-				collaborators.insert(other.first);
+		for (const auto& connection: other.connections) {
+			if (id == connection.targetId)	{
+				collaborators.insert(other.id);
 			}
 		}
 	}
 	for (const auto& usage: c.memberUsages) {
-		if (usage.type != CLASS_USAGE || m_classes.find(usage.targetId) == m_classes.end()) continue;
+		if (usage.type != CLASS_USAGE || !FindClass(usage.targetId)) continue;
 		collaborators.insert(usage.targetId);
 	}
 	for (const auto& collaborator: collaborators) {
 		const _TCHAR* type = nullptr;
-		switch(m_classes.at(collaborator).data.type) {
+		switch(GetClass(collaborator).data.type) {
 		case Class::CLASS: type = _T("class"); break;
 		case Class::STRUCT: type = _T("struct"); break;
 		}
-		if (m_classes.at(collaborator).data.interface) {
+		if (GetClass(collaborator).data.interface) {
 			type = _T("interface");
 		}
 
 		std::vector<string> classes;
-		if (m_classes.at(collaborator).utility) {
+		if (GetClass(collaborator).utility) {
 			classes.push_back(_T("utility"));
 		}
-		file.WriteNode(collaborator, m_classes.at(collaborator).name, collaborator, collaborator, type, nullptr, m_classes.at(collaborator).data.doxygenId, m_classes.at(collaborator).data.filename, m_classes.at(collaborator).data.description, classes);
+		file.WriteNode(collaborator, GetClass(collaborator).name, collaborator, collaborator, type, Symbol(), GetClass(collaborator).data.doxygenId, GetClass(collaborator).data.filename, GetClass(collaborator).data.description, classes);
 	}
 
 
 
 	if (!c.parentId.empty()) {
-		file.WriteEdge(_T("class"), c.parentId, _T("parent"));
+		file.WriteEdge(classNode, c.parentId, _T("parent"));
 	}
 
 	for (const auto& method: c.methodOverrides) {
@@ -798,7 +1177,7 @@ void ClassManager::WriteSingleClassJson(const stringRef& id) const
 	}
 
 	for (const auto& usage: c.memberUsages) {
-		if (usage.type == CLASS_USAGE && m_classes.find(usage.targetId) == m_classes.end()) continue;
+		if (usage.type == CLASS_USAGE && !FindClass(usage.targetId)) continue;
 
 		const _TCHAR* type = nullptr;
 		switch(usage.type) {
@@ -829,16 +1208,16 @@ void ClassManager::WriteSingleClassJson(const stringRef& id) const
 				classes.push_back(_T("virtual"));
 			}
 			classes.push_back(GetProtectionLevel(connection.protectionLevel));
-			file.WriteEdge(_T("class"), connection.targetId, _T("derives"), connection.connectionCode, classes);
+			file.WriteEdge(classNode, connection.targetId, _T("derives"), connection.connectionCode, classes);
 		}
 	}
 
 	for (const auto& collaborator: collaborators) {
-		if (m_classes.at(collaborator).parentId == id.str()) {
-			file.WriteEdge(collaborator, _T("class"), _T("parent"));
+		if (id == GetClass(collaborator).parentId) {
+			file.WriteEdge(collaborator, classNode, _T("parent"));
 		}
-		for (const auto& connection: m_classes.at(collaborator).connections) {
-			if (connection.targetId == id.str())	{
+		for (const auto& connection: GetClass(collaborator).connections) {
+			if (id == connection.targetId)	{
 
 				const _TCHAR* type = nullptr;
 				switch (connection.type)
@@ -858,26 +1237,26 @@ void ClassManager::WriteSingleClassJson(const stringRef& id) const
 				}
 				classes.push_back(GetProtectionLevel(connection.protectionLevel));
 
-				file.WriteEdge(collaborator, _T("class"), type, connection.connectionCode, classes);
+				file.WriteEdge(collaborator, classNode, type, connection.connectionCode, classes);
 			}
 		}
 	}
 
 }
 
-void ClassManager::WriteNamespaceJson(const stringRef& namespaceId, bool external) const
+void ClassManager::WriteNamespaceJson(const Symbol& namespaceId, bool external) const
 {
-	JsonWriter file(m_outputDir + _T("\\") + GetNamespaceFileName(namespaceId, external) + _T(".json"));
+	JsonWriter file(FileSystem::Combine(m_outputDir, GetNamespaceFileName(namespaceId, external) + _T(".json")));
 	
-	std::set<string> namespaces;
-	namespaces.insert(namespaceId.str());
+	std::set<Symbol> namespaces;
+	namespaces.insert(namespaceId);
 	{
 		bool newAdded = true;
 		while(newAdded) {
 			newAdded = false;
 			for (const auto& n: m_namespaces) {
-				if (!namespaces.count(n.first) && namespaces.count(n.second.parentId)) {
-					namespaces.insert(n.first);
+				if (!namespaces.count(n.id) && namespaces.count(n.parentId)) {
+					namespaces.insert(n.id);
 					newAdded = true;
 				}
 			}
@@ -885,45 +1264,45 @@ void ClassManager::WriteNamespaceJson(const stringRef& namespaceId, bool externa
 	}
 
 
-	std::set<string> insideClasses;
-	std::set<string> outsideClasses;
+	std::set<Symbol> insideClasses;
+	std::set<Symbol> outsideClasses;
 	for (const auto& c: m_classes) {
-		if (namespaces.count(c.second.namespaceId)) {
-			insideClasses.insert(c.first);
-			for (const auto& connection: c.second.connections) {
+		if (namespaces.count(c.namespaceId)) {
+			insideClasses.insert(c.id);
+			for (const auto& connection: c.connections) {
 				outsideClasses.insert(connection.targetId);
 			}
 		}
 	}
 	for (const auto& c: m_classes) {
-		for (const auto& connection: c.second.connections) {
+		for (const auto& connection: c.connections) {
 			if (insideClasses.count(connection.targetId)) {
-				outsideClasses.insert(c.first);
-				namespaces.insert(c.second.namespaceId);
+				outsideClasses.insert(c.id);
+				namespaces.insert(c.namespaceId);
 			}
 		}
 	}
 
 
 	for (const auto& c: m_classes) {
-		if (!insideClasses.count(c.first) && (!external || !outsideClasses.count(c.first))) {
+		if (!insideClasses.count(c.id) && (!external || !outsideClasses.count(c.id))) {
 			continue;
 		}
 
 		// strip the utility classes
-		if (c.second.utility) continue;
+		if (c.utility) continue;
 
 		const _TCHAR* type = nullptr;
-		switch(c.second.data.type) {
+		switch(c.data.type) {
 		case Class::STRUCT: type = _T("struct"); break;
 		case Class::CLASS: type = _T("class"); break;
 		}
-		if (c.second.data.interface) {
+		if (c.data.interface) {
 			type = _T("interface");
 		}
-		file.WriteNode(c.first, c.second.name, c.first, c.first, type, c.second.namespaceId, c.second.data.doxygenId, c.second.data.filename, c.second.data.description);
+		file.WriteNode(c.id, c.name, c.id, c.id, type, c.namespaceId, c.data.doxygenId, c.data.filename, c.data.description);
 
-		for (const auto& connection: c.second.connections) {
+		for (const auto& connection: c.connections) {
 
 			const _TCHAR* type = nullptr;
 			switch (connection.type)
@@ -943,17 +1322,17 @@ void ClassManager::WriteNamespaceJson(const stringRef& namespaceId, bool externa
 			}
 			classes.push_back(GetProtectionLevel(connection.protectionLevel));
 
-			file.WriteEdge(c.first, connection.targetId, type, connection.connectionCode, classes);
+			file.WriteEdge(c.id, connection.targetId, type, connection.connectionCode, classes);
 		}
 
-		if (!c.second.parentId.empty()) {
-			file.WriteEdge(c.first, c.second.parentId, _T("parent"));
+		if (!c.parentId.empty()) {
+			file.WriteEdge(c.id, c.parentId, _T("parent"));
 		}
 	}
 
 	for (auto& n: namespaces) {
-		if (m_namespaces.count(n)) {
-			file.WriteNode(n, m_namespaces.at(n).name, n, nullptr, _T("namespace"), m_namespaces.at(n).parentId, !external && namespaceId == n.c_str() ? _T("") : GetNamespaceFileName(n, namespaceId != n.c_str()));
+		if (const Namespace* entry = FindNamespace(n)) {
+			file.WriteNode(n, entry->name, n, nullptr, _T("namespace"), entry->parentId, !external && namespaceId == n ? _T("") : GetNamespaceFileName(n, namespaceId != n));
 		}
 	}
 
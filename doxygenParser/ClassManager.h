@@ -2,11 +2,13 @@
 #define CLASS_MANAGER_H__
 
 #include "types.h"
+#include "Symbol.h"
+#include "ScopeIndex.h"
 #include "xml/structure.h"
 #include <vector>
 #include <map>
 #include <set>
-#include <mutex>
+#include <memory>
 
 
 enum EProtectionLevel {
@@ -17,29 +19,29 @@ enum EProtectionLevel {
 };
 
 struct Member {
-	string name;
-	string type;
+	Symbol name;
+	Symbol type;
 	string description;
 	EProtectionLevel protectionLevel;
 };
 
 struct Method {
-	string name;
-	string doxygenId;
+	Symbol name;
+	Symbol doxygenId;
 	string description;
-	string returnType;
+	Symbol returnType;
 	bool Const;
 	bool Virtual;
 	bool Override;
 
 	struct Param {
-		string type;
-		string name;
+		Symbol type;
+		Symbol name;
 	};
 	std::vector<Param> params;
 	EProtectionLevel protectionLevel;
 
-	string locationFile;
+	Symbol locationFile;
 	string bodyBeginLine;
 	string bodyEndLine;
 
@@ -48,7 +50,7 @@ struct Method {
 };
 
 struct Inheritance {
-	string classId;
+	Symbol classId;
 	EProtectionLevel protLevel;
 	bool Virtual;
 };
@@ -59,9 +61,9 @@ struct Class {
 		CLASS
 	};
 
-	string name;
-	string doxygenId;
-	string filename; //!< declaration file
+	Symbol name;
+	Symbol doxygenId;
+	Symbol filename; //!< declaration file
 	string description;
 	EType type;
 	bool templated;
@@ -76,10 +78,65 @@ struct Class {
 struct ClassManager {
 	ClassManager(const stringRef& outputDir) : m_outputDir(outputDir.str()) {}
 
+	// compounds collected by ProcessDef, one buffer per worker
+	struct Definitions {
+		std::vector<Class> classes;
+		std::vector<Symbol> namespaces;
+	};
+
+	enum EMemberUsageType {
+		METHOD_CALL,
+		MEMBER_ACCESS,
+		CLASS_USAGE
+	};
+
+	struct MemberUsage {
+		Symbol sourceMethodId; //!< doxygenId of calling method
+		string connectionCode; //!< source line of usage/parameter/return value
+		Symbol targetId; //!< either doxygen method id or member name
+		EMemberUsageType type;
+		bool certain; //!< whether the access is evident from the 
+
+		MemberUsage() : certain(true) {}
+	};
+
+	typedef std::vector<std::pair<Symbol, MemberUsage>> Usages; //!< class id -> usage, as found by ProcessFileDef
+
 	void Initialize();
 
-	void ProcessDef(const Element& classDef);
-	void ProcessFileDef(const Element& fileDef);
+	static void ProcessDef(const Element& classDef, Definitions& definitions);
+	void AddDefinitions(Definitions&& definitions);
+	void ProcessFileDef(const Element& fileDef, Usages& usages) const;
+	void AddUsages(Usages&& usages);
+
+	// What the usages ProcessFileDef finds depend on besides the code, appended to `out` as
+	// bytes, so usages cached for a file can be reused while it is unchanged. The class names
+	// part is the same for every file: the ids, names and namespaces of all classes, which
+	// the usable class names are made of. The file part covers the classes with methods at
+	// the `locations` of the file compounds: their members and methods, with the body lines
+	// of the methods located there.
+	void DescribeClassNames(std::string& out) const;
+	void DescribeFileModel(const std::vector<string>& locations, std::string& out) const;
+
+	// Finds the usages in the program listing of a file compound, like ProcessFileDef, with
+	// the code lines fed one at a time in listing order. The listing is thus never needed
+	// as a whole, it can be streamed.
+	class FileScanner {
+	public:
+		FileScanner(const ClassManager& manager, const stringRef& location);
+		~FileScanner();
+
+		void AddLine(const Element& codeline);
+		// appends the usages found, in the order ProcessFileDef gives them in
+		void Finish(Usages& usages);
+
+	private:
+		FileScanner(const FileScanner&);
+		FileScanner& operator=(const FileScanner&);
+
+		struct State;
+		std::unique_ptr<State> m_state;
+	};
 
 	void WriteClassesJson();
 	void WriteSingleClassJsons() const;
@@ -87,8 +144,9 @@ struct ClassManager {
 
 private:
 	struct Namespace {
-		string name;
-		string parentId;
+		Symbol id; //!< qualified name
+		Symbol name;
+		Symbol parentId;
 	};
 
 	enum EClassConnectionType {
@@ -98,67 +156,68 @@ private:
 	};
 
 	struct ClassConnection {
-		string targetId;
+		Symbol targetId;
 		string connectionCode;
-		string connectedMember;
+		Symbol connectedMember;
 		EClassConnectionType type;
 		bool Virtual;
 		EProtectionLevel protectionLevel;
 	};
 
-	enum EMemberUsageType {
-		METHOD_CALL,
-		MEMBER_ACCESS,
-		CLASS_USAGE
-	};
-
-	struct MemberUsage {
-		string sourceMethodId; //!< doxygenId of calling method
-		string connectionCode; //!< source line of usage/parameter/return value
-		string targetId; //!< either doxygen method id or member name
-		EMemberUsageType type;
-		bool certain; //!< whether the access is evident from the 
-
-		MemberUsage() : certain(true) {}
-	};
-
 	struct ClassEntry {
-		string name;
+		Symbol id; //!< qualified name
+		Symbol name;
 		Class data;
-		string namespaceId;
-		string parentId;
+		Symbol namespaceId;
+		Symbol parentId;
 		std::vector<ClassConnection> connections; // connection to other classes (via inheritance or composition via members)
 		std::vector<MemberUsage> memberUsages;
-		std::map<string, string> methodOverrides; //!< method doxygenId -> interface id
+		std::map<Symbol, Symbol> methodOverrides; //!< method doxygenId -> interface id
 		bool utility; //!< flag whether this class is utility only
 
 		ClassEntry() : utility(false) {}
 	};
 
 private:
-	void CalculateNamespaces(const std::vector<string>& namespaces);
+	void CalculateNamespaces(const std::vector<Symbol>& namespaces);
 	void CalculateClasses(const std::vector<Class>& classes);
+	// fills `entry` for the class `item`, adding the classes it marks as utilities to `utilityClasses`
+	void BuildClassEntry(const Class& item, ClassEntry& entry, std::vector<Symbol>& utilityClasses) const;
 	void CalculateMethods();
 	void ClearOrphanItems();
 
+	// the entry of the class `id`, nullptr if there is none
+	const ClassEntry* FindClass(const Symbol& id) const;
+	ClassEntry* FindClass(const Symbol& id);
+	// the entry of the class `id`, which has to exist
+	const ClassEntry& GetClass(const Symbol& id) const { return m_classes.at(m_classIndex.Find(id)); }
+	ClassEntry& GetClass(const Symbol& id) { return m_classes.at(m_classIndex.Find(id)); }
+	// the entry of the namespace `id`, nullptr if there is none
+	const Namespace* FindNamespace(const Symbol& id) const;
+
 	static string GetLastId(const string& name);
 	static string GetWithoutLastId(const string& name);
 
-	std::vector<ClassConnection> GetConnections(const string& type, const string& namespaceId, const std::set<string>& ids, EProtectionLevel protLevel, bool Virtual = false) const;
-	void WriteSingleClassJson(const stringRef& id) const;
-	void WriteNamespaceJson(const stringRef& namespaceId, bool external) const;
+	// the classes `type` refers to, resolved in the namespace `namespaceId`
+	std::vector<ClassConnection> GetConnections(const string& type, const stringRef& namespaceId, EProtectionLevel protLevel, bool Virtual = false) const;
+	void WriteSingleClassJson(const Symbol& id) const;
+	void WriteNamespaceJson(const Symbol& namespaceId, bool external) const;
 
 	// search string -> class id
-	std::map<string, string> GetUsableClasses(const stringRef& classId, const stringRef& namespaceId) const;
+	std::map<string, Symbol> GetUsableClasses(const Symbol& classId, const Symbol& namespaceId) const;
 
 private:
-	std::map<string, Namespace> m_namespaces; //!< id -> Namespace
-	std::map<string, ClassEntry> m_classes; //!< id -> ClassEntry
+	// The entries are kept in dense vectors, sorted by id once the model is built, which is
+	// the order of the output. The indexes map the ids to positions in them.
+	std::vector<Namespace> m_namespaces;
+	SymbolIndex m_namespaceIndex; //!< id -> position in m_namespaces
+	std::vector<ClassEntry> m_classes;
+	SymbolIndex m_classIndex; //!< id -> position in m_classes
+	ScopeIndex m_classNames; //!< the qualified names of all the classes read, by scope
 	string m_outputDir;
-	std::mutex m_lock;
 
 	std::vector<Class> initClasses;
-	std::vector<string> initNamespaces;
+	std::vector<Symbol> initNamespaces;
 };
 
 #endif // CLASS_MANAGER_H__
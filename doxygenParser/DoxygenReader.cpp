@@ -0,0 +1,461 @@
+#include "DoxygenReader.h"
+#include "Cache.h"
+#include "ClassManager.h"
+#include "FileSystem.h"
+#include "Keyword.h"
+#include "BoundedQueue.h"
+#include "xml/XmlDocument.h"
+#include "xml/XmlFile.h"
+#include "xml/XmlStream.h"
+#include <algorithm>
+#include <atomic>
+#include <iterator>
+#include <thread>
+
+#ifdef _OPENMP
+#include <omp.h>
+#else
+inline int omp_get_max_threads() { return 1; }
+inline int omp_get_thread_num() { return 0; }
+#endif
+
+// Inputs bigger than this many bytes are not loaded and parsed whole, they are streamed one
+// subtree after the other (XmlStream), so the memory needed does not grow with them.
+#ifndef DOXYGEN_STREAMED_FILE_SIZE
+#define DOXYGEN_STREAMED_FILE_SIZE (64 * 1024 * 1024)
+#endif
+
+namespace {
+	const int READER_THREADS = 2; //!< threads loading the input ahead of the parsers
+	const std::size_t PREFETCH_FILES = 64; //!< loaded files waiting for a parser at most
+
+	typedef std::pair<int, std::unique_ptr<XmlFile>> LoadedFile; //!< input index -> content
+
+	// Subtrees of compounds ProcessDef never looks at. Cutting them out of the text before
+	// parsing keeps the class extraction proportional to the declarations, not to the sources.
+	const _TCHAR* const SKIPPED_ELEMENT_NAMES[] = {
+		_T("programlisting"), _T("detaileddescription"), _T("inbodydescription"),
+		_T("listofallmembers"), _T("inheritancegraph"), _T("collaborationgraph"),
+	};
+	const std::vector<string> SKIPPED_DEFINITION_ELEMENTS(std::begin(SKIPPED_ELEMENT_NAMES), std::end(SKIPPED_ELEMENT_NAMES));
+	// Subtrees ProcessDef reads the whole text of, code listings included. Nothing is cut inside them.
+	const std::vector<string> KEPT_DEFINITION_ELEMENTS(1, _T("briefdescription"));
+
+	const std::size_t HEAD_SIZE = 4096; //!< bytes read to find the compounddef tag of a file
+
+	enum ECompound {
+		COMPOUND_UNKNOWN, //!< no complete compounddef tag in the text
+		COMPOUND_FILE,
+		COMPOUND_DEFINITION
+	};
+
+	// Kind of the (single) compounddef of a not yet parsed doxygen xml text of length `size`,
+	// be it the whole content or just its head.
+	template<typename Char>
+	ECompound ClassifyCompound(const Char* text, std::size_t size)
+	{
+		static const char compoundTag[] = "<compounddef ";
+		static const char kindFile[] = " kind=\"file\"";
+		const Char* const end = text + size;
+
+		const Char* const tag = std::search(text, end, compoundTag, compoundTag + sizeof(compoundTag) - 1);
+		if (tag == end) return COMPOUND_UNKNOWN;
+		const Char* const tagEnd = std::find(tag, end, '>');
+		if (tagEnd == end) return COMPOUND_UNKNOWN;
+		return std::search(tag, tagEnd, kindFile, kindFile + sizeof(kindFile) - 1) != tagEnd ? COMPOUND_FILE : COMPOUND_DEFINITION;
+	}
+
+	// whether the file starts with a file compound, judged by a bounded read of its head
+	bool HeadIsFileCompound(const string& filename)
+	{
+		char head[HEAD_SIZE];
+		return ClassifyCompound(head, XmlFile::ReadHead(filename, head, HEAD_SIZE)) == COMPOUND_FILE;
+	}
+
+	// Loads `files` on reader threads into a bounded queue, while the OpenMP workers take them
+	// from it and call process(worker index, input index, content). With a cold page cache the
+	// disk latency is thus hidden behind the parsing. The files are loaded in `order`, if given.
+	// Files bigger than DOXYGEN_STREAMED_FILE_SIZE are handed over Oversized, not loaded.
+	// With `skipFileCompounds`, files whose head shows a file compound are neither mapped nor
+	// prefetched, their content is handed over null.
+	template<typename Process>
+	void ForEachFile(const std::vector<string>& files, const std::vector<int>& order, bool skipFileCompounds, Process process)
+	{
+		BoundedQueue<LoadedFile> queue(PREFETCH_FILES);
+		std::atomic<int> next(0);
+		std::atomic<int> activeReaders(READER_THREADS);
+
+		std::vector<std::thread> readers;
+		for (int i = 0; i < READER_THREADS; i++) {
+			readers.push_back(std::thread([&]{
+				for (int position = next++; position < static_cast<int>(files.size()); position = next++) {
+					const int file = order.empty() ? position : order[position];
+					if (skipFileCompounds && HeadIsFileCompound(files[file])) {
+						queue.Push(LoadedFile(file, nullptr));
+						continue;
+					}
+					std::unique_ptr<XmlFile> content(new XmlFile(files[file], DOXYGEN_STREAMED_FILE_SIZE));
+					content->Prefetch();
+					queue.Push(LoadedFile(file, std::move(content)));
+				}
+				if (--activeReaders == 0) {
+					queue.Close();
+				}
+			}));
+		}
+
+		#pragma omp parallel
+		{
+			const int worker = omp_get_thread_num();
+			LoadedFile file;
+			while (queue.Pop(file)) {
+				process(worker, file.first, std::move(file.second));
+			}
+		}
+
+		for (auto& reader : readers) {
+			reader.join();
+		}
+	}
+
+	// Moves the stream into the <doxygen> root element, to its compounds. Returns false if
+	// the file has no such root.
+	bool EnterRoot(XmlStream& stream)
+	{
+		while (stream.Next()) {
+			if (stream.Name() == _T("doxygen")) {
+				stream.Enter();
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// Hashes the content of a file too big to be loaded, the same way Cache::Hash does a loaded one.
+	Cache::Key HashFile(const string& filename)
+	{
+		XmlStream stream(filename);
+		Cache::Hasher hasher(stream.Size() * sizeof(_TCHAR));
+		stream.Observe([&hasher](const _TCHAR* data, std::size_t size) { hasher.Update(data, size * sizeof(_TCHAR)); });
+		stream.Drain();
+		return hasher.Final();
+	}
+
+	// ProcessFileDef for the file compounds of a file too big to be loaded. The location of
+	// a compound follows its program listing, so the file is streamed twice: first for the
+	// `locations` of the C++ file compounds, then for the code lines, which are fed to a
+	// FileScanner one by one.
+	void StreamFileDefs(const ClassManager& classManager, const string& filename, ClassManager::Usages& usages, std::vector<string>& locations)
+	{
+		{
+			XmlStream stream(filename);
+			if (!EnterRoot(stream)) return;
+			while (stream.Next()) {
+				if (stream.Name() != _T("compounddef")) continue;
+				const Element def = stream.Tag();
+				if (DecodeKeyword(def.GetAttribute(_T("language"))) != KW_CPP || DecodeKeyword(def.GetAttribute(_T("kind"))) != KW_FILE) continue;
+
+				string location;
+				bool found = false;
+				stream.Enter();
+				while (stream.Next()) {
+					if (!found && stream.Name() == _T("location")) {
+						location = stream.Tag().GetAttribute(_T("file")).str();
+						found = true;
+					}
+				}
+				locations.push_back(location);
+			}
+		}
+
+		XmlStream stream(filename);
+		if (!EnterRoot(stream)) return;
+		std::vector<string>::const_iterator location = locations.begin();
+		while (stream.Next() && location != locations.end()) {
+			if (stream.Name() != _T("compounddef")) continue;
+			const Element def = stream.Tag();
+			if (DecodeKeyword(def.GetAttribute(_T("language"))) != KW_CPP || DecodeKeyword(def.GetAttribute(_T("kind"))) != KW_FILE) continue;
+
+			ClassManager::FileScanner scanner(classManager, *location++);
+			bool found = false;
+			stream.Enter();
+			while (stream.Next()) {
+				if (found || stream.Name() != _T("programlisting")) continue;
+				found = true;
+				stream.Enter();
+				while (stream.Next()) {
+					if (stream.Name() == _T("codeline")) {
+						scanner.AddLine(stream.Read());
+					}
+				}
+			}
+			scanner.Finish(usages);
+		}
+	}
+}
+
+// Parsed input file. A worker loads one file after the other into the same document.
+struct DoxygenReader::Document {
+	void Load(std::unique_ptr<XmlFile>&& content) {
+		doc.clear();
+		file = std::move(content);
+		if (*file) {
+			doc.parse<0>(file->Data());
+		}
+	}
+
+	Element Root(const stringRef& name = _T("doxygen")) const { return doc.first_node(name.str()); }
+
+	std::unique_ptr<XmlFile> file;
+	XmlDocument doc;
+};
+
+DoxygenReader::DoxygenReader(const stringRef& inputDir, Cache* cache) : m_inputDir(inputDir.str()), m_classifyDefinitions(false), m_cache(cache), m_modelHash(0)
+{
+	if (!ReadIndex()) {
+		m_classifyDefinitions = true;
+		const std::vector<FileSystem::File> files = FileSystem::ScanFiles(m_inputDir, _T("xml"), true);
+		for (const auto& file : files) {
+			m_definitionFiles.push_back(file.path);
+		}
+
+		// the largest compounds first, so no worker is left with a big one at the end
+		for (int i = 0; i < static_cast<int>(files.size()); i++) {
+			m_definitionOrder.push_back(i);
+		}
+		std::stable_sort(m_definitionOrder.begin(), m_definitionOrder.end(), [&files](int a, int b) {
+			return files[a].size > files[b].size;
+		});
+	}
+}
+
+bool DoxygenReader::ReadIndex()
+{
+	std::unique_ptr<XmlFile> content(new XmlFile(FileSystem::Combine(m_inputDir, _T("index.xml"))));
+	if (!*content) return false;
+
+	Document index;
+	index.Load(std::move(content));
+	const Element root = index.Root(_T("doxygenindex"));
+	if (!root) return false;
+
+	for (const auto& compound : root.Elements(_T("compound"))) {
+		const string filename = FileSystem::Combine(m_inputDir, string(compound.GetAttribute(_T("refid")).str()) + _T(".xml"));
+		switch (DecodeKeyword(compound.GetAttribute(_T("kind")))) {
+		case KW_CLASS:
+		case KW_STRUCT:
+		case KW_NAMESPACE:
+			m_definitionFiles.push_back(filename);
+			break;
+		case KW_FILE:
+			m_sourceFiles.push_back(filename);
+			break;
+		default:
+			break;
+		}
+	}
+	return true;
+}
+
+DoxygenReader::~DoxygenReader()
+{
+	#pragma omp parallel
+	XmlDocument::ReleaseCachedBlocks();
+}
+
+// Output of one ReadDefinitions worker. The segments remember which part of the buffers
+// came from which input file, so the workers can be merged back in input order.
+struct DoxygenReader::Worker {
+	struct Segment {
+		int file;
+		std::size_t classes, classesEnd;
+		std::size_t namespaces, namespacesEnd;
+		bool sourceFile; //!< file compound, left to ProcessFiles
+
+		bool operator<(const Segment& that) const { return file < that.file; }
+	};
+
+	Worker() : cache(nullptr), key(0) {}
+
+	void Read(int file, const string& filename, std::unique_ptr<XmlFile>&& content) {
+		key = 0;
+
+		Segment segment;
+		segment.file = file;
+		segment.classes = definitions.classes.size();
+		segment.namespaces = definitions.namespaces.size();
+		// file compounds can only be analysed once all the classes are known
+		if (!content) {
+			segment.sourceFile = true; // told by its head, not loaded
+		} else if (content->Oversized()) {
+			segment.sourceFile = !Stream(filename);
+		} else {
+			segment.sourceFile = *content && ClassifyCompound(content->Data(), content->Size()) == COMPOUND_FILE;
+			if (!segment.sourceFile) {
+				Extract(std::move(content));
+			}
+		}
+		segment.classesEnd = definitions.classes.size();
+		segment.namespacesEnd = definitions.namespaces.size();
+
+		if (key) {
+			ClassManager::Definitions extracted;
+			extracted.classes.assign(definitions.classes.begin() + segment.classes, definitions.classes.end());
+			extracted.namespaces.assign(definitions.namespaces.begin() + segment.namespaces, definitions.namespaces.end());
+			cache->Store(key, extracted);
+		}
+		segments.push_back(segment);
+	}
+
+	void Extract(std::unique_ptr<XmlFile>&& content) {
+		if (!*content) return;
+
+		if (cache) {
+			const Cache::Key hash = Cache::Hash(content->Data(), content->Size() * sizeof(_TCHAR));
+			if (cache->Load(hash, definitions)) return;
+			key = hash;
+		}
+
+		content->Truncate(stripElements(content->Data(), content->Size(), SKIPPED_DEFINITION_ELEMENTS, KEPT_DEFINITION_ELEMENTS));
+		if (!document) {
+			document.reset(new Document);
+		}
+		document->Load(std::move(content));
+		for (const auto& def : document->Root().Elements(_T("compounddef"))) {
+			if (DecodeKeyword(def.GetAttribute(_T("language"))) == KW_CPP && DecodeKeyword(def.GetAttribute(_T("kind"))) != KW_FILE) {
+				ClassManager::ProcessDef(def, definitions);
+			}
+		}
+	}
+
+	// Extract for a file too big to be loaded: the compounds are read from the stream one by
+	// one, without the skipped elements. Returns false for a file compound, left unread.
+	bool Stream(const string& filename) {
+		XmlStream stream(filename);
+		if (!EnterRoot(stream)) return true;
+
+		bool first = true;
+		while (stream.Next()) {
+			if (stream.Name() != _T("compounddef")) continue;
+			const Element def = stream.Tag();
+			const bool cpp = DecodeKeyword(def.GetAttribute(_T("language"))) == KW_CPP;
+			const bool fileCompound = DecodeKeyword(def.GetAttribute(_T("kind"))) == KW_FILE;
+			if (first) {
+				first = false;
+				if (fileCompound) return false;
+
+				// the whole content is hashed before anything is parsed
+				if (cache) {
+					const Cache::Key hash = HashFile(filename);
+					if (cache->Load(hash, definitions)) return true;
+					key = hash;
+				}
+			}
+			if (cpp && !fileCompound) {
+				ClassManager::ProcessDef(stream.Read(SKIPPED_DEFINITION_ELEMENTS, KEPT_DEFINITION_ELEMENTS), definitions);
+			}
+		}
+		return true;
+	}
+
+	Cache* cache;
+	Cache::Key key; //!< content hash of the file just extracted, 0 if there is nothing to store
+	ClassManager::Definitions definitions;
+	std::unique_ptr<Document> document; //!< reused for the next file
+	std::vector<Segment> segments;
+};
+
+void DoxygenReader::ReadDefinitions(ClassManager& classManager)
+{
+	std::vector<Worker> workers(omp_get_max_threads());
+	for (auto& worker : workers) {
+		worker.cache = m_cache;
+	}
+	ForEachFile(m_definitionFiles, m_definitionOrder, m_classifyDefinitions, [&](int worker, int file, std::unique_ptr<XmlFile>&& content) {
+		workers[worker].Read(file, m_definitionFiles[file], std::move(content));
+	});
+
+	// merge the worker buffers in input order, independently of which worker got which file
+	std::vector<std::pair<Worker::Segment, Worker*>> segments;
+	for (auto& worker : workers) {
+		for (const auto& segment : worker.segments) {
+			segments.push_back(std::make_pair(segment, &worker));
+		}
+	}
+	std::sort(segments.begin(), segments.end(), [](const std::pair<Worker::Segment, Worker*>& a, const std::pair<Worker::Segment, Worker*>& b) {
+		return a.first < b.first;
+	});
+
+	ClassManager::Definitions definitions;
+	for (const auto& item : segments) {
+		const Worker::Segment& segment = item.first;
+		Worker& worker = *item.second;
+		for (std::size_t i = segment.classes; i < segment.classesEnd; i++) {
+			definitions.classes.push_back(std::move(worker.definitions.classes[i]));
+		}
+		for (std::size_t i = segment.namespaces; i < segment.namespacesEnd; i++) {
+			definitions.namespaces.push_back(std::move(worker.definitions.namespaces[i]));
+		}
+		if (segment.sourceFile) {
+			m_sourceFiles.push_back(m_definitionFiles[segment.file]);
+		}
+	}
+
+	classManager.AddDefinitions(std::move(definitions));
+}
+
+void DoxygenReader::ProcessFiles(ClassManager& classManager)
+{
+	// collected per file and added in input order, whichever worker found them
+	std::vector<ClassManager::Usages> usages(m_sourceFiles.size());
+
+	// The usages of a file only depend on the class names and on the classes with methods in
+	// the file, so a change elsewhere in the model keeps them cached.
+	if (m_cache) {
+		std::string classNames;
+		classManager.DescribeClassNames(classNames);
+		m_modelHash = Cache::Hash(classNames.data(), classNames.size());
+	}
+	const Cache::ModelKey modelKey = [&](const std::vector<string>& locations) {
+		std::string model(reinterpret_cast<const char*>(&m_modelHash), sizeof(m_modelHash));
+		classManager.DescribeFileModel(locations, model);
+		return Cache::Hash(model.data(), model.size());
+	};
+
+	std::vector<std::unique_ptr<Document>> documents(omp_get_max_threads());
+	ForEachFile(m_sourceFiles, std::vector<int>(), false, [&](int worker, int file, std::unique_ptr<XmlFile>&& content) {
+		if (!*content && !content->Oversized()) return;
+
+		Cache::Key key = 0;
+		if (m_cache) {
+			key = content->Oversized() ? HashFile(m_sourceFiles[file]) : Cache::Hash(content->Data(), content->Size() * sizeof(_TCHAR));
+			if (m_cache->Load(key, modelKey, usages[file])) return;
+		}
+
+		std::vector<string> locations; //!< of the C++ file compounds
+		if (content->Oversized()) {
+			StreamFileDefs(classManager, m_sourceFiles[file], usages[file], locations);
+		} else {
+			std::unique_ptr<Document>& document = documents[worker];
+			if (!document) {
+				document.reset(new Document);
+			}
+			document->Load(std::move(content));
+			for (const auto& def : document->Root().Elements(_T("compounddef"))) {
+				if (DecodeKeyword(def.GetAttribute(_T("language"))) == KW_CPP && DecodeKeyword(def.GetAttribute(_T("kind"))) == KW_FILE) {
+					const stringRef location = def.GetElement(_T("location")).GetAttribute(_T("file"));
+					locations.push_back(string(location.str(), location.size()));
+					classManager.ProcessFileDef(def, usages[file]);
+				}
+			}
+		}
+
+		if (m_cache) {
+			m_cache->Store(key, locations, modelKey(locations), usages[file]);
+		}
+	});
+
+	for (auto& fileUsages : usages) {
+		classManager.AddUsages(std::move(fileUsages));
+	}
+}
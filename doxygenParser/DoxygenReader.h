@@ -0,0 +1,46 @@
+#ifndef DOXYGEN_READER_H__
+#define DOXYGEN_READER_H__
+
+#include "types.h"
+#include "xml/structure.h"
+#include <vector>
+#include <memory>
+
+struct ClassManager;
+class Cache;
+
+// Reads the doxygen xml output directory. Every input file is parsed only once: reader
+// threads load the files ahead, as many workers as there are cores parse them.
+// Class and namespace compounds are extracted into per-worker buffers and merged in
+// input order, the usages found in the file compounds are added in input order as well.
+// If the directory has an index.xml, only the compounds listed there as class, struct or
+// namespace are opened for the definitions and the file compounds for the source files
+// analysis. Otherwise every *.xml file below the directory is read for definitions, the
+// biggest ones first, and the file compounds found among them, told apart by a short read
+// of their head without loading them, are left to the source files analysis.
+// With a cache, files whose content was seen by a previous run are not parsed at all.
+// Very big files are not loaded whole but streamed: one compound, respectively one code
+// line, is parsed at a time.
+struct DoxygenReader {
+	DoxygenReader(const stringRef& inputDir, Cache* cache = nullptr);
+	~DoxygenReader();
+
+	void ReadDefinitions(ClassManager& classManager);
+	void ProcessFiles(ClassManager& classManager);
+
+private:
+	struct Document;
+	struct Worker;
+
+	bool ReadIndex();
+
+	string m_inputDir;
+	std::vector<string> m_definitionFiles; //!< files to be read by ReadDefinitions
+	std::vector<int> m_definitionOrder; //!< order to load m_definitionFiles in, empty for as listed
+	bool m_classifyDefinitions; //!< m_definitionFiles may be file compounds, to be told apart by their head
+	std::vector<string> m_sourceFiles; //!< file compounds to be read by ProcessFiles
+	Cache* m_cache;
+	unsigned long long m_modelHash; //!< Cache::Hash of the class names of the model
+};
+
+#endif // DOXYGEN_READER_H__
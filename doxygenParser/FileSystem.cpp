@@ -1,40 +1,99 @@
 #include "FileSystem.h"
+#include <algorithm>
+
+#ifdef _WIN32
 #include <windows.h>
 #include <Shlwapi.h>
+#else
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+#endif
 
-std::vector<string> FileSystem::GetFiles(const stringRef& directory, const stringRef& extension) {
+namespace {
+	bool HasSuffix(const _TCHAR* name, const string& suffix)
+	{
+		const std::size_t length = std::char_traits<_TCHAR>::length(name);
+		if (length <= suffix.size()) return false;
+#ifdef _WIN32
+		return _tcsicmp(name + length - suffix.size(), suffix.c_str()) == 0;
+#else
+		return suffix.compare(name + length - suffix.size()) == 0;
+#endif
+	}
 
-	string targetDir(directory.str());
-	if(targetDir.back() != _T('\\')) {
-		targetDir.append(_T("\\"));
+	bool PathLess(const FileSystem::File& a, const FileSystem::File& b)
+	{
+		return a.path < b.path;
 	}
+}
 
-	string target(targetDir);
-	if (extension) {
-		target.append(_T("*.")).append(extension.str());
-	} else {
-		target.append(_T("*.*"));
+string FileSystem::Combine(const stringRef& directory, const stringRef& name)
+{
+	string result(directory.str());
+	if (!result.empty() && result.back() != PathSeparator) {
+		result.append(1, PathSeparator);
 	}
-	
+	return result.append(name.str());
+}
+
+std::vector<string> FileSystem::GetFiles(const stringRef& directory, const stringRef& extension, bool recursive)
+{
 	std::vector<string> result;
-	WIN32_FIND_DATA data;
-	HANDLE hFind = FindFirstFile(target.c_str(), &data);
-	if (hFind != INVALID_HANDLE_VALUE) {
+	for (auto& file : ScanFiles(directory, extension, recursive)) {
+		result.push_back(std::move(file.path));
+	}
+	return result;
+}
+
+#ifdef _WIN32
+
+std::vector<FileSystem::File> FileSystem::ScanFiles(const stringRef& directory, const stringRef& extension, bool recursive)
+{
+	const string suffix = extension ? string(_T(".")) + extension.str() : string();
+
+	std::vector<File> result;
+	std::vector<string> directories(1, Combine(directory, _T("")));
+	while (!directories.empty()) {
+		const string targetDir = directories.back();
+		directories.pop_back();
+
+		WIN32_FIND_DATA data;
+		HANDLE hFind = FindFirstFile((targetDir + _T("*")).c_str(), &data);
+		if (hFind == INVALID_HANDLE_VALUE) continue;
 		do {
-			result.push_back(targetDir + data.cFileName);
+			if (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+				if (recursive && _tcscmp(data.cFileName, _T(".")) != 0 && _tcscmp(data.cFileName, _T("..")) != 0) {
+					directories.push_back(Combine(targetDir + data.cFileName, _T("")));
+				}
+			} else if (HasSuffix(data.cFileName, suffix)) {
+				File file;
+				file.path = targetDir + data.cFileName;
+				file.size = (static_cast<unsigned long long>(data.nFileSizeHigh) << 32) | data.nFileSizeLow;
+				result.push_back(std::move(file));
+			}
 		} while (FindNextFile(hFind, &data));
 		FindClose(hFind);
 	}
 
+	std::sort(result.begin(), result.end(), PathLess);
 	return result;
 }
 
 bool FileSystem::CreateRecursiveDirectory(const stringRef& filepath)
 {
     bool result = false;
-    wchar_t path_copy[MAX_PATH] = {0};
-	wcscat_s(path_copy, MAX_PATH, filepath.str());
-    std::vector<std::wstring> path_collection;
+    _TCHAR path_copy[MAX_PATH] = {0};
+	_tcscat_s(path_copy, MAX_PATH, filepath.str());
+    std::vector<string> path_collection;
 
     for(int level=0; PathRemoveFileSpec(path_copy); level++)
     {
@@ -47,4 +106,196 @@ bool FileSystem::CreateRecursiveDirectory(const stringRef& filepath)
                 result = true;
     }
     return result;
-};
\ No newline at end of file
+};
+
+#else
+
+namespace {
+	const std::size_t STAT_CHUNK = 512; //!< files a single scan task stats at most
+
+	// Calls callback(name, d_type) for every entry of the open directory `dir`.
+	template<typename Callback>
+	void ForEachEntry(int dir, Callback callback)
+	{
+#ifdef __linux__
+		// raw getdents64, a single syscall per buffer full of entries and no DIR allocation
+		struct Entry {
+			unsigned long long ino;
+			long long off;
+			unsigned short reclen;
+			unsigned char type;
+			char name[1];
+		};
+		char buffer[64 * 1024];
+		long size;
+		while ((size = syscall(SYS_getdents64, dir, buffer, sizeof(buffer))) > 0) {
+			for (long offset = 0; offset < size;) {
+				const Entry* entry = reinterpret_cast<const Entry*>(buffer + offset);
+				callback(entry->name, entry->type);
+				offset += entry->reclen;
+			}
+		}
+#else
+		const int fd = dup(dir);
+		if (fd < 0) return;
+		if (DIR* stream = fdopendir(fd)) {
+			while (const dirent* entry = readdir(stream)) {
+				callback(entry->d_name, entry->d_type);
+			}
+			closedir(stream);
+		} else {
+			close(fd);
+		}
+#endif
+	}
+
+	// Work shared by the ScanFiles threads: listing directories and stating the matching files
+	// in them. A big directory is split into several stat tasks, so even a flat doxygen output
+	// directory is stated in parallel.
+	class Scanner {
+	public:
+		Scanner(const string& suffix, bool recursive) : m_suffix(suffix), m_recursive(recursive), m_busy(0) {}
+
+		void Add(const string& directory, std::vector<string>&& names = std::vector<string>()) {
+			std::lock_guard<std::mutex> lock(m_lock);
+			m_tasks.push_back(Task());
+			m_tasks.back().directory = directory;
+			m_tasks.back().names.swap(names);
+			m_changed.notify_one();
+		}
+
+		void Run(std::vector<FileSystem::File>& result) {
+			while (true) {
+				Task task;
+				{
+					std::unique_lock<std::mutex> lock(m_lock);
+					m_changed.wait(lock, [this]{ return !m_tasks.empty() || m_busy == 0; });
+					if (m_tasks.empty()) return; // nothing queued and nobody left to queue more
+
+					task.directory.swap(m_tasks.back().directory);
+					task.names.swap(m_tasks.back().names);
+					m_tasks.pop_back();
+					m_busy++;
+				}
+
+				const int dir = open(task.directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+				if (dir >= 0) {
+					if (task.names.empty()) {
+						List(dir, task.directory, result);
+					} else {
+						Stat(dir, task.directory, task.names, result);
+					}
+					close(dir);
+				}
+
+				std::lock_guard<std::mutex> lock(m_lock);
+				if (--m_busy == 0 && m_tasks.empty()) {
+					m_changed.notify_all();
+				}
+			}
+		}
+
+	private:
+		struct Task {
+			string directory; //!< with a trailing separator
+			std::vector<string> names; //!< files to be stated, empty to list the directory
+		};
+
+		void List(int dir, const string& directory, std::vector<FileSystem::File>& result) {
+			std::vector<string> files;
+			ForEachEntry(dir, [&](const char* name, unsigned char type) {
+				if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) return;
+
+				if (type == DT_UNKNOWN) {
+					struct stat info;
+					if (fstatat(dir, name, &info, AT_SYMLINK_NOFOLLOW) != 0) return;
+					type = S_ISDIR(info.st_mode) ? DT_DIR : S_ISLNK(info.st_mode) ? DT_LNK : S_ISREG(info.st_mode) ? DT_REG : DT_UNKNOWN;
+				}
+
+				if (type == DT_DIR) {
+					if (m_recursive) {
+						Add(directory + name + FileSystem::PathSeparator);
+					}
+				} else if ((type == DT_REG || type == DT_LNK) && HasSuffix(name, m_suffix)) {
+					files.push_back(name);
+				}
+			});
+
+			while (files.size() > STAT_CHUNK) {
+				std::vector<string> chunk(files.end() - STAT_CHUNK, files.end());
+				files.resize(files.size() - STAT_CHUNK);
+				Add(directory, std::move(chunk));
+			}
+			Stat(dir, directory, files, result);
+		}
+
+		void Stat(int dir, const string& directory, const std::vector<string>& names, std::vector<FileSystem::File>& result) {
+			for (const auto& name : names) {
+				struct stat info;
+				if (fstatat(dir, name.c_str(), &info, 0) == 0 && S_ISREG(info.st_mode)) {
+					FileSystem::File file;
+					file.path = directory + name;
+					file.size = static_cast<unsigned long long>(info.st_size);
+					result.push_back(std::move(file));
+				}
+			}
+		}
+
+	private:
+		const string m_suffix;
+		const bool m_recursive;
+		int m_busy; //!< tasks being processed
+		std::vector<Task> m_tasks;
+		std::mutex m_lock;
+		std::condition_variable m_changed;
+	};
+
+	// creates `directory` and, only if that fails for their absence, its parents
+	bool MakeDirectory(const string& directory)
+	{
+		if (mkdir(directory.c_str(), 0777) == 0) return true;
+		if (errno != ENOENT) return false;
+
+		const std::size_t parentEnd = directory.find_last_of(FileSystem::PathSeparator);
+		if (parentEnd == string::npos || parentEnd == 0) return false;
+		MakeDirectory(directory.substr(0, parentEnd));
+		return mkdir(directory.c_str(), 0777) == 0;
+	}
+}
+
+std::vector<FileSystem::File> FileSystem::ScanFiles(const stringRef& directory, const stringRef& extension, bool recursive)
+{
+	Scanner scanner(extension ? string(_T(".")) + extension.str() : string(), recursive);
+	scanner.Add(Combine(directory, _T("")));
+
+	const unsigned threadCount = std::max(1u, std::min(8u, std::thread::hardware_concurrency()));
+	std::vector<std::vector<File>> results(threadCount);
+	std::vector<std::thread> threads;
+	for (unsigned i = 1; i < threadCount; i++) {
+		threads.push_back(std::thread([&scanner, &results, i]{ scanner.Run(results[i]); }));
+	}
+	scanner.Run(results[0]);
+	for (auto& thread : threads) {
+		thread.join();
+	}
+
+	std::vector<File> result;
+	for (auto& files : results) {
+		std::move(files.begin(), files.end(), std::back_inserter(result));
+	}
+	std::sort(result.begin(), result.end(), PathLess);
+	return result;
+}
+
+bool FileSystem::CreateRecursiveDirectory(const stringRef& filepath)
+{
+	// like PathRemoveFileSpec, everything after the last separator is the file name
+	string directory(filepath.str());
+	directory.erase(std::min(directory.find_last_of(PathSeparator), directory.size()));
+	while (directory.size() > 1 && directory.back() == PathSeparator) {
+		directory.erase(directory.size() - 1);
+	}
+	return !directory.empty() && MakeDirectory(directory);
+}
+
+#endif
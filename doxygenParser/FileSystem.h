@@ -5,8 +5,22 @@
 #include <vector>
 
 struct FileSystem {
-	static std::vector<string> GetFiles(const stringRef& directory, const stringRef& extension = nullptr);
+#ifdef _WIN32
+	static const _TCHAR PathSeparator = _T('\\');
+#else
+	static const _TCHAR PathSeparator = _T('/');
+#endif
+
+	struct File {
+		string path;
+		unsigned long long size;
+	};
+
+	// files sorted by path; the sizes allow to schedule the biggest inputs first
+	static std::vector<File> ScanFiles(const stringRef& directory, const stringRef& extension = nullptr, bool recursive = false);
+	static std::vector<string> GetFiles(const stringRef& directory, const stringRef& extension = nullptr, bool recursive = false);
 	static bool CreateRecursiveDirectory(const stringRef& filepath);
+	static string Combine(const stringRef& directory, const stringRef& name);
 };
 
 #endif // FILE_SYSTEM_H__
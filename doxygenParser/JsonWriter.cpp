@@ -3,13 +3,96 @@
 #include <set>
 #include "xml/structure.h"
 
-string escape(string s)
-{
-	string result = replaceAll(std::move(s), _T("\\"), _T("\\\\"));
-	result = replaceAll(std::move(result), _T("\""), _T("\\\""));
-	result = replaceAll(std::move(result), _T("\n"), _T("\\n"));
-	result = replaceAll(std::move(result), _T("\t"), _T("\\t"));
-	return result;
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define JSON_ESCAPE_SSE2
+#endif
+
+namespace {
+	// a quote, a backslash or a control character, which can not appear in a JSON string as is
+	inline bool needsEscape(_TCHAR c)
+	{
+		return c == _T('"') || c == _T('\\') || static_cast<unsigned>(c) < 0x20;
+	}
+
+#ifdef JSON_ESCAPE_SSE2
+	// bit mask of the bytes of the 16 byte block at `text` belonging to characters to be escaped
+	template<std::size_t CharSize> struct EscapeMask;
+	template<> struct EscapeMask<1> {
+		static int Get(const void* text) {
+			const __m128i block = _mm_loadu_si128(static_cast<const __m128i*>(text));
+			const __m128i special = _mm_or_si128(
+				_mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8('"')), _mm_cmpeq_epi8(block, _mm_set1_epi8('\\'))),
+				_mm_cmpeq_epi8(_mm_subs_epu8(block, _mm_set1_epi8(0x1f)), _mm_setzero_si128())); // <= 0x1f
+			return _mm_movemask_epi8(special);
+		}
+	};
+	template<> struct EscapeMask<2> {
+		static int Get(const void* text) {
+			const __m128i block = _mm_loadu_si128(static_cast<const __m128i*>(text));
+			const __m128i special = _mm_or_si128(
+				_mm_or_si128(_mm_cmpeq_epi16(block, _mm_set1_epi16('"')), _mm_cmpeq_epi16(block, _mm_set1_epi16('\\'))),
+				_mm_cmpeq_epi16(_mm_subs_epu16(block, _mm_set1_epi16(0x1f)), _mm_setzero_si128())); // <= 0x1f
+			return _mm_movemask_epi8(special);
+		}
+	};
+#endif
+
+	// length of the run of characters at the start of `text` that need no escaping
+	std::size_t cleanSpan(const _TCHAR* text, std::size_t size)
+	{
+		std::size_t i = 0;
+#ifdef JSON_ESCAPE_SSE2
+		const std::size_t blockSize = sizeof(__m128i) / sizeof(_TCHAR);
+		while (i + blockSize <= size && EscapeMask<sizeof(_TCHAR)>::Get(text + i) == 0) {
+			i += blockSize;
+		}
+#endif
+		while (i < size && !needsEscape(text[i])) {
+			i++;
+		}
+		return i;
+	}
+
+	// Writes the string as the content of a JSON string in a single pass: the runs of clean
+	// characters are copied as they are, quotes, backslashes and control characters escaped.
+	struct Escaped {
+		explicit Escaped(const string& value) : m_value(value) {}
+
+		const string& m_value;
+	};
+
+	std::basic_ostream<_TCHAR>& operator<<(std::basic_ostream<_TCHAR>& out, const Escaped& escaped)
+	{
+		const _TCHAR* text = escaped.m_value.c_str();
+		std::size_t size = escaped.m_value.size();
+		while (size) {
+			const std::size_t clean = cleanSpan(text, size);
+			out.write(text, clean);
+			text += clean;
+			size -= clean;
+			if (!size) break;
+
+			const _TCHAR c = *text++;
+			size--;
+			switch (c) {
+			case _T('"'): out << _T("\\\""); break;
+			case _T('\\'): out << _T("\\\\"); break;
+			case _T('\n'): out << _T("\\n"); break;
+			case _T('\t'): out << _T("\\t"); break;
+			case _T('\r'): out << _T("\\r"); break;
+			case _T('\b'): out << _T("\\b"); break;
+			case _T('\f'): out << _T("\\f"); break;
+			default: {
+				const _TCHAR* const digits = _T("0123456789abcdef");
+				const _TCHAR code[] = { _T('\\'), _T('u'), _T('0'), _T('0'), digits[(c >> 4) & 0xf], digits[c & 0xf] };
+				out.write(code, sizeof(code) / sizeof(code[0]));
+				break;
+			}
+			}
+		}
+		return out;
+	}
 }
 
 
@@ -25,26 +108,26 @@ JsonWriter::~JsonWriter()
 			first = false;
 
 			std::basic_ostringstream<_TCHAR> s;
-			s	<< _T("{\"id\":\"") << escape(node.first)
-				<< _T("\", \"shortName\":\"") << escape(node.second.shortName)
-				<< _T("\", \"type\":\"") << escape(node.second.type);
+			s	<< _T("{\"id\":\"") << Escaped(node.first.str())
+				<< _T("\", \"shortName\":\"") << Escaped(node.second.shortName)
+				<< _T("\", \"type\":\"") << Escaped(node.second.type);
 			if (!node.second.parent.empty() && m_nodes.count(node.second.parent)) {
-				s << _T("\", \"parent\":\"") << escape(node.second.parent);
+				s << _T("\", \"parent\":\"") << Escaped(node.second.parent.str());
 			}
 			if (!node.second.longName.empty()) {
-				s << _T("\", \"longName\":\"") << escape(node.second.longName);
+				s << _T("\", \"longName\":\"") << Escaped(node.second.longName);
 			}
 			if (!node.second.hoverName.empty()) {
-				s << _T("\", \"hoverName\":\"") << escape(node.second.hoverName);
+				s << _T("\", \"hoverName\":\"") << Escaped(node.second.hoverName);
 			}
 			if (!node.second.reference.empty()) {
-				s << _T("\", \"reference\":\"") << escape(node.second.reference);
+				s << _T("\", \"reference\":\"") << Escaped(node.second.reference);
 			}
 			if (!node.second.filename.empty()) {
-				s << _T("\", \"filename\":\"") << escape(node.second.filename);
+				s << _T("\", \"filename\":\"") << Escaped(node.second.filename);
 			}
 			if (!node.second.description.empty()) {
-				s << _T("\", \"description\":\"") << escape(node.second.description);
+				s << _T("\", \"description\":\"") << Escaped(node.second.description);
 			}
 			if (!node.second.classes.empty()) {
 				s << _T("\", \"classes\":[");
@@ -54,7 +137,7 @@ JsonWriter::~JsonWriter()
 						s << _T(",");
 					}
 					first = false;
-					s << _T("\"") << escape(c) << _T("\"");
+					s << _T("\"") << Escaped(c) << _T("\"");
 				}
 				s << _T("]}");
 			} else s << _T("\"}");
@@ -75,11 +158,11 @@ JsonWriter::~JsonWriter()
 			first = false;
 
 			std::basic_ostringstream<_TCHAR> s;
-			s	<< _T("{\"source\":\"") << escape(edge.sourceId)
-				<< _T("\", \"target\":\"") << escape(edge.targetId)
-				<< _T("\", \"type\":\"") << escape(edge.type);
+			s	<< _T("{\"source\":\"") << Escaped(edge.sourceId.str())
+				<< _T("\", \"target\":\"") << Escaped(edge.targetId.str())
+				<< _T("\", \"type\":\"") << Escaped(edge.type);
 			if (!edge.description.empty()) {
-				s << _T("\", \"description\":\"") << escape(edge.description);
+				s << _T("\", \"description\":\"") << Escaped(edge.description);
 			}
 			if (!edge.classes.empty()) {
 				s << _T("\", \"classes\":[");
@@ -89,7 +172,7 @@ JsonWriter::~JsonWriter()
 						s << _T(",");
 					}
 					first = false;
-					s << _T("\"") << escape(c) << _T("\"");
+					s << _T("\"") << Escaped(c) << _T("\"");
 				}
 				s << _T("]}");
 			} else s << _T("\"}");
@@ -101,35 +184,35 @@ JsonWriter::~JsonWriter()
 	if (m_classId.empty()) {
 		m_file << std::endl << _T("]}") << std::endl;
 	} else {
-		m_file << std::endl << _T("], \"class\":\"") << escape(m_classId) << _T("\"}") << std::endl;
+		m_file << std::endl << _T("], \"class\":\"") << Escaped(m_classId) << _T("\"}") << std::endl;
 	}
 	
 	m_file.close();
 }
 
-void JsonWriter::WriteNode(const stringRef& id, const stringRef& shortName, const stringRef& longName, const stringRef& hoverName, const stringRef& type,
-		const stringRef& parent, const stringRef& reference, const stringRef& filename, const stringRef& description, const std::vector<string>& classes)
+void JsonWriter::WriteNode(const Symbol& id, const stringRef& shortName, const stringRef& longName, const stringRef& hoverName, const stringRef& type,
+		const Symbol& parent, const stringRef& reference, const stringRef& filename, const stringRef& description, const std::vector<string>& classes)
 {
 	SNode node;
 	node.shortName = shortName.str();
 	node.longName = longName.str();
 	node.hoverName = hoverName.str();
 	node.type = type.str();
-	node.parent = parent.str();
+	node.parent = parent;
 	node.reference = reference.str();
 	node.filename = filename.str();
 	node.description = description.str();
 	node.classes = classes;
 
-	m_nodes.insert(std::map<string, SNode>::value_type(id.str(), std::move(node)));
+	m_nodes.insert(std::map<Symbol, SNode>::value_type(id, std::move(node)));
 }
 
-void JsonWriter::WriteEdge(const stringRef& sourceId, const stringRef& targetId, const stringRef& type,
+void JsonWriter::WriteEdge(const Symbol& sourceId, const Symbol& targetId, const stringRef& type,
 		const stringRef& description, const std::vector<string>& classes)
 {
 	SEdge edge;
-	edge.sourceId = sourceId.str();
-	edge.targetId = targetId.str();
+	edge.sourceId = sourceId;
+	edge.targetId = targetId;
 	edge.type = type.str();
 	edge.description = description.str();
 	edge.classes = classes;
@@ -140,7 +223,7 @@ void JsonWriter::WriteEdge(const stringRef& sourceId, const stringRef& targetId,
 void JsonWriter::ClearOrphans()
 {
 	while(true) {
-		std::set<string> ids;
+		std::set<Symbol> ids;
 		for (const auto& node: m_nodes) {
 			ids.insert(node.first);
 		}
@@ -160,7 +243,7 @@ void JsonWriter::ClearOrphans()
 
 		for (const auto& node: m_nodes) {
 			if (ids.find(node.first) == ids.end()) {
-				string parent = node.second.parent;
+				Symbol parent = node.second.parent;
 				do {
 					ids.erase(parent);
 					if (m_nodes.count(parent)) {
@@ -2,6 +2,7 @@
 #define JSON_WRITER_H___
 
 #include "types.h"
+#include "Symbol.h"
 #include <vector>
 #include <map>
 #include <fstream>
@@ -10,10 +11,10 @@ struct JsonWriter {
 	JsonWriter(const stringRef& filePath, const stringRef& classId = nullptr) : m_file(filePath.str()), m_classId(classId.str()) {}
 	~JsonWriter();
 
-	void WriteNode(const stringRef& id, const stringRef& shortName, const stringRef& longName, const stringRef& hoverName, const stringRef& type,
-		const stringRef& parent = nullptr, const stringRef& reference = nullptr, const stringRef& filename = nullptr, const stringRef& description = nullptr,
+	void WriteNode(const Symbol& id, const stringRef& shortName, const stringRef& longName, const stringRef& hoverName, const stringRef& type,
+		const Symbol& parent = Symbol(), const stringRef& reference = nullptr, const stringRef& filename = nullptr, const stringRef& description = nullptr,
 		const std::vector<string>& classes = std::vector<string>());
-	void WriteEdge(const stringRef& sourceId, const stringRef& targetId, const stringRef& type,
+	void WriteEdge(const Symbol& sourceId, const Symbol& targetId, const stringRef& type,
 		const stringRef& description = nullptr, const std::vector<string>& classes = std::vector<string>());
 
 	void ClearOrphans();
@@ -24,7 +25,7 @@ private:
 		string longName;
 		string hoverName;
 		string type;
-		string parent;
+		Symbol parent;
 		string reference;
 		string filename;
 		string description;
@@ -32,15 +33,15 @@ private:
 	};
 
 	struct SEdge {
-		string sourceId;
-		string targetId;
+		Symbol sourceId;
+		Symbol targetId;
 		string type;
 		string description;
 		std::vector<string> classes;
 	};
 
 private:
-	std::map<string, SNode> m_nodes;
+	std::map<Symbol, SNode> m_nodes;
 	std::vector<SEdge> m_edges;
 	std::basic_ofstream<_TCHAR> m_file;
 	string m_classId;
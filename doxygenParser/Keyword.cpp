@@ -0,0 +1,86 @@
+#include "Keyword.h"
+
+namespace {
+	struct Word {
+		const _TCHAR* text;
+		EKeyword keyword;
+	};
+
+	const Word WORDS[] = {
+		{ _T("class"), KW_CLASS },
+		{ _T("struct"), KW_STRUCT },
+		{ _T("union"), KW_UNION },
+		{ _T("interface"), KW_INTERFACE },
+		{ _T("namespace"), KW_NAMESPACE },
+		{ _T("file"), KW_FILE },
+		{ _T("dir"), KW_DIR },
+		{ _T("page"), KW_PAGE },
+		{ _T("function"), KW_FUNCTION },
+		{ _T("variable"), KW_VARIABLE },
+		{ _T("typedef"), KW_TYPEDEF },
+		{ _T("enum"), KW_ENUM },
+		{ _T("define"), KW_DEFINE },
+		{ _T("friend"), KW_FRIEND },
+		{ _T("public"), KW_PUBLIC },
+		{ _T("protected"), KW_PROTECTED },
+		{ _T("private"), KW_PRIVATE },
+		{ _T("package"), KW_PACKAGE },
+		{ _T("non-virtual"), KW_NON_VIRTUAL },
+		{ _T("virtual"), KW_VIRTUAL },
+		{ _T("pure-virtual"), KW_PURE_VIRTUAL },
+		{ _T("yes"), KW_YES },
+		{ _T("no"), KW_NO },
+		{ _T("C++"), KW_CPP },
+		{ _T("comment"), KW_COMMENT },
+		{ _T("normal"), KW_NORMAL },
+		{ _T("preprocessor"), KW_PREPROCESSOR },
+		{ _T("keyword"), KW_KEYWORD },
+		{ _T("keywordtype"), KW_KEYWORDTYPE },
+		{ _T("keywordflow"), KW_KEYWORDFLOW },
+		{ _T("stringliteral"), KW_STRINGLITERAL },
+		{ _T("charliteral"), KW_CHARLITERAL },
+	};
+
+	const std::size_t TABLE_SIZE = 128; //!< power of two, well above the number of words
+
+	// Open addressing table of the words by their hash, filled before main runs.
+	struct Table {
+		struct Slot {
+			std::size_t hash;
+			const Word* word;
+		};
+
+		Table() {
+			for (std::size_t i = 0; i < TABLE_SIZE; i++) {
+				slots[i].hash = 0;
+				slots[i].word = nullptr;
+			}
+			for (const auto& word : WORDS) {
+				const std::size_t hash = stringRef(word.text).hash();
+				std::size_t i = hash & (TABLE_SIZE - 1);
+				while (slots[i].word) {
+					i = (i + 1) & (TABLE_SIZE - 1);
+				}
+				slots[i].hash = hash;
+				slots[i].word = &word;
+			}
+		}
+
+		Slot slots[TABLE_SIZE];
+	};
+
+	const Table table;
+}
+
+EKeyword DecodeKeyword(const stringRef& word)
+{
+	if (!word) return KW_UNKNOWN;
+
+	const std::size_t hash = word.hash();
+	for (std::size_t i = hash & (TABLE_SIZE - 1); table.slots[i].word; i = (i + 1) & (TABLE_SIZE - 1)) {
+		if (table.slots[i].hash == hash && word == table.slots[i].word->text) {
+			return table.slots[i].word->keyword;
+		}
+	}
+	return KW_UNKNOWN;
+}
@@ -0,0 +1,59 @@
+#ifndef KEYWORD_H__
+#define KEYWORD_H__
+
+#include "types.h"
+
+// Attribute values of the doxygen xml schema the parser branches on. A value is decoded
+// once, with a single hash and table probe, and then dispatched on with a switch.
+enum EKeyword {
+	KW_UNKNOWN,
+
+	// compound and member kinds
+	KW_CLASS,
+	KW_STRUCT,
+	KW_UNION,
+	KW_INTERFACE,
+	KW_NAMESPACE,
+	KW_FILE,
+	KW_DIR,
+	KW_PAGE,
+	KW_FUNCTION,
+	KW_VARIABLE,
+	KW_TYPEDEF,
+	KW_ENUM,
+	KW_DEFINE,
+	KW_FRIEND,
+
+	// prot
+	KW_PUBLIC,
+	KW_PROTECTED,
+	KW_PRIVATE,
+	KW_PACKAGE,
+
+	// virt
+	KW_NON_VIRTUAL,
+	KW_VIRTUAL,
+	KW_PURE_VIRTUAL,
+
+	// yes / no flags (const, static, abstract...)
+	KW_YES,
+	KW_NO,
+
+	// language
+	KW_CPP,
+
+	// highlight classes of the program listings
+	KW_COMMENT,
+	KW_NORMAL,
+	KW_PREPROCESSOR,
+	KW_KEYWORD,
+	KW_KEYWORDTYPE,
+	KW_KEYWORDFLOW,
+	KW_STRINGLITERAL,
+	KW_CHARLITERAL
+};
+
+// the keyword `word` stands for, KW_UNKNOWN if it is none
+EKeyword DecodeKeyword(const stringRef& word);
+
+#endif // KEYWORD_H__
@@ -0,0 +1,112 @@
+#include "ScopeIndex.h"
+
+namespace {
+	// position of the last `::` in `value`, npos if there is none
+	std::size_t FindLastSeparator(const stringRef& value)
+	{
+		const _TCHAR* const str = value.str();
+		for (std::size_t i = value.size(); i-- > 1;) {
+			if (str[i] == _T(':') && str[i - 1] == _T(':')) return i - 1;
+		}
+		return string::npos;
+	}
+}
+
+std::size_t ScopeIndex::Hash(const stringRef& scope, const stringRef& name)
+{
+	const std::size_t hash = name.hash();
+	return scope ? hash ^ (scope.hash() + 0x9e3779b9 + (hash << 6) + (hash >> 2)) : hash;
+}
+
+void ScopeIndex::Add(const Symbol& id)
+{
+	if (id.empty() || !Find(id).empty()) return;
+
+	Insert(id, 0);
+	const string& value = id.str();
+	for (std::size_t i = 1; i + 1 < value.size(); i++) {
+		if (value[i] == _T(':') && value[i + 1] == _T(':')) {
+			Insert(id, i);
+		}
+	}
+}
+
+void ScopeIndex::Clear()
+{
+	m_slots.clear();
+	m_count = 0;
+}
+
+Symbol ScopeIndex::Resolve(const stringRef& name, const stringRef& scope) const
+{
+	const Symbol found = Find(name);
+	if (!found.empty()) return found;
+
+	std::size_t scopeSize = scope.size();
+	while (scopeSize) {
+		const stringRef current(scope.str(), scopeSize);
+		const Symbol qualified = Probe(current, name);
+		if (!qualified.empty()) return qualified;
+
+		scopeSize = FindLastSeparator(current);
+		if (scopeSize == string::npos) break;
+	}
+	return Symbol();
+}
+
+Symbol ScopeIndex::Probe(const stringRef& scope, const stringRef& name) const
+{
+	if (m_slots.empty()) return Symbol();
+
+	const std::size_t mask = m_slots.size() - 1;
+	const std::size_t hash = Hash(scope, name);
+	for (std::size_t i = hash & mask; !m_slots[i].id.empty(); i = (i + 1) & mask) {
+		const Slot& slot = m_slots[i];
+		if (slot.hash != hash || slot.scopeSize != scope.size()) continue;
+
+		const string& value = slot.id.str();
+		const std::size_t nameStart = slot.scopeSize ? slot.scopeSize + 2 : 0;
+		if (stringRef(value.c_str(), slot.scopeSize) == scope && stringRef(value.c_str() + nameStart, value.size() - nameStart) == name) {
+			return slot.id;
+		}
+	}
+	return Symbol();
+}
+
+void ScopeIndex::Insert(const Symbol& id, std::size_t scopeSize)
+{
+	if ((m_count + 1) * 2 > m_slots.size()) {
+		Grow();
+	}
+
+	const string& value = id.str();
+	const std::size_t nameStart = scopeSize ? scopeSize + 2 : 0;
+	Slot slot;
+	slot.hash = Hash(stringRef(value.c_str(), scopeSize), stringRef(value.c_str() + nameStart, value.size() - nameStart));
+	slot.id = id;
+	slot.scopeSize = scopeSize;
+
+	const std::size_t mask = m_slots.size() - 1;
+	std::size_t i = slot.hash & mask;
+	while (!m_slots[i].id.empty()) {
+		i = (i + 1) & mask;
+	}
+	m_slots[i] = slot;
+	m_count++;
+}
+
+void ScopeIndex::Grow()
+{
+	std::vector<Slot> slots(m_slots.empty() ? 256 : m_slots.size() * 2);
+	slots.swap(m_slots);
+	for (const auto& slot : slots) {
+		if (slot.id.empty()) continue;
+
+		const std::size_t mask = m_slots.size() - 1;
+		std::size_t i = slot.hash & mask;
+		while (!m_slots[i].id.empty()) {
+			i = (i + 1) & mask;
+		}
+		m_slots[i] = slot;
+	}
+}
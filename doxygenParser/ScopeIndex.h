@@ -0,0 +1,41 @@
+#ifndef SCOPE_INDEX_H__
+#define SCOPE_INDEX_H__
+
+#include "types.h"
+#include "Symbol.h"
+#include <vector>
+
+// Resolves names as written inside a scope to the qualified names indexed. A name `x`
+// written in the scope `a::b` stands for `x`, `a::b::x` or `a::x`, the first one indexed.
+// Every qualified name is indexed under each of its scopes, so resolving takes a table
+// probe per enclosing scope, without building any of the candidate strings.
+class ScopeIndex {
+public:
+	ScopeIndex() : m_count(0) {}
+
+	void Add(const Symbol& id);
+	void Clear();
+
+	// the indexed name `name`, the empty symbol if it is not indexed
+	Symbol Find(const stringRef& name) const { return Probe(stringRef(), name); }
+	// the indexed name `name` stands for in `scope`, the empty symbol if none
+	Symbol Resolve(const stringRef& name, const stringRef& scope) const;
+
+private:
+	// an indexed name split at one of its `::`, the whole name under the empty scope
+	struct Slot {
+		std::size_t hash;
+		Symbol id; //!< empty for a free slot
+		std::size_t scopeSize; //!< the scope is the id up to here, the name follows the `::`
+	};
+
+	static std::size_t Hash(const stringRef& scope, const stringRef& name);
+	Symbol Probe(const stringRef& scope, const stringRef& name) const;
+	void Insert(const Symbol& id, std::size_t scopeSize);
+	void Grow();
+
+	std::vector<Slot> m_slots; //!< power of two sized, at most half full
+	std::size_t m_count;
+};
+
+#endif // SCOPE_INDEX_H__
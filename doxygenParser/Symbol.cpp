@@ -0,0 +1,145 @@
+#include "Symbol.h"
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+
+namespace {
+	const unsigned SHARD_BITS = 6;
+	const unsigned SHARD_COUNT = 1 << SHARD_BITS; //!< independently locked parts of the table
+	const unsigned BLOCK_BITS = 16;
+	const unsigned BLOCK_SIZE = 1 << BLOCK_BITS; //!< strings per block of the id -> string table
+
+	struct Shard {
+		std::mutex lock;
+		std::deque<string> strings; //!< stable storage of the interned strings
+		std::unordered_map<stringRef, unsigned> ids; //!< views of strings -> id
+	};
+
+	Shard shards[SHARD_COUNT];
+
+	// The shard is picked by the top bits of the hash: the maps of the shards bucket by its
+	// low bits (hash & mask on VS2012), which would otherwise be the same for all their keys.
+	Shard& ShardOf(const stringRef& value)
+	{
+		return shards[value.hash() >> (sizeof(std::size_t) * 8 - SHARD_BITS)];
+	}
+	std::atomic<unsigned> nextId(1); // 0 is the empty string
+	// Id -> string, in blocks allocated on first use. A block is never moved, so strings can
+	// be looked up without locking, while other threads intern further strings.
+	std::atomic<const string**> blocks[1 << (32 - BLOCK_BITS)];
+	const string emptyString;
+
+	const string*& Slot(unsigned id)
+	{
+		std::atomic<const string**>& block = blocks[id >> BLOCK_BITS];
+		const string** strings = block.load();
+		if (!strings) {
+			const string** const allocated = new const string*[BLOCK_SIZE];
+			if (block.compare_exchange_strong(strings, allocated)) {
+				strings = allocated;
+			} else {
+				delete[] allocated;
+			}
+		}
+		return strings[id & (BLOCK_SIZE - 1)];
+	}
+}
+
+Symbol::Symbol(const stringRef& value) : m_id(0)
+{
+	if (!value) return;
+
+	Shard& shard = ShardOf(value);
+	std::lock_guard<std::mutex> guard(shard.lock);
+	const auto found = shard.ids.find(value);
+	if (found != shard.ids.end()) {
+		m_id = found->second;
+		return;
+	}
+
+	shard.strings.push_back(string(value.str(), value.size()));
+	const string& stored = shard.strings.back();
+	m_id = nextId++;
+	Slot(m_id) = &stored;
+	shard.ids.insert(std::make_pair(stringRef(stored.c_str(), stored.size()), m_id));
+}
+
+Symbol Symbol::Find(const stringRef& value)
+{
+	Symbol result;
+	if (!value) return result;
+
+	Shard& shard = ShardOf(value);
+	std::lock_guard<std::mutex> guard(shard.lock);
+	const auto found = shard.ids.find(value);
+	if (found != shard.ids.end()) {
+		result.m_id = found->second;
+	}
+	return result;
+}
+
+const string& Symbol::str() const
+{
+	return m_id ? *blocks[m_id >> BLOCK_BITS].load(std::memory_order_relaxed)[m_id & (BLOCK_SIZE - 1)] : emptyString;
+}
+
+std::size_t SymbolIndex::Probe(unsigned id) const
+{
+	const std::size_t mask = m_slots.size() - 1;
+	std::size_t i = static_cast<unsigned>(id * 0x9e3779b9u) >> m_shift;
+	while (m_slots[i].id != 0 && m_slots[i].id != id) {
+		i = (i + 1) & mask;
+	}
+	return i;
+}
+
+std::size_t SymbolIndex::Find(const Symbol& symbol) const
+{
+	if (m_slots.empty() || symbol.empty()) return NOT_FOUND;
+
+	const Slot& slot = m_slots[Probe(symbol.id())];
+	return slot.id ? slot.position : NOT_FOUND;
+}
+
+std::size_t SymbolIndex::Insert(const Symbol& symbol, std::size_t position)
+{
+	if (symbol.empty()) return NOT_FOUND;
+
+	if ((m_count + 1) * 2 > m_slots.size()) {
+		Grow();
+	}
+	Slot& slot = m_slots[Probe(symbol.id())];
+	if (!slot.id) {
+		slot.id = symbol.id();
+		slot.position = static_cast<unsigned>(position);
+		m_count++;
+	}
+	return slot.position;
+}
+
+void SymbolIndex::Clear()
+{
+	m_slots.clear();
+	m_shift = 32;
+	m_count = 0;
+}
+
+void SymbolIndex::Grow()
+{
+	std::vector<Slot> slots(m_slots.empty() ? 64 : m_slots.size() * 2);
+	m_shift = 32;
+	for (std::size_t size = slots.size(); size > 1; size >>= 1) {
+		m_shift--;
+	}
+	for (auto& slot : slots) {
+		slot.id = 0;
+		slot.position = 0;
+	}
+	slots.swap(m_slots);
+	for (const auto& slot : slots) {
+		if (slot.id) {
+			m_slots[Probe(slot.id)] = slot;
+		}
+	}
+}
@@ -0,0 +1,69 @@
+#ifndef SYMBOL_H__
+#define SYMBOL_H__
+
+#include "types.h"
+#include <functional>
+#include <vector>
+
+// Interned string. Equal strings share one 32 bit symbol, so the model keeps a single copy
+// of every id, name and type and compares them as integers. The table is global and
+// thread-safe, interned strings live until the end of the program.
+// Symbols are ordered by their strings, sorted containers of them keep the output order.
+class Symbol {
+public:
+	Symbol() : m_id(0) {}
+	// interns `value`, the empty string is the default symbol
+	explicit Symbol(const stringRef& value);
+
+	// the symbol of `value` if it is interned already, the empty symbol otherwise
+	static Symbol Find(const stringRef& value);
+
+	const string& str() const;
+	operator stringRef() const { return stringRef(str().c_str(), str().size()); }
+
+	unsigned id() const { return m_id; }
+	bool empty() const { return m_id == 0; }
+
+	bool operator==(const Symbol& that) const { return m_id == that.m_id; }
+	bool operator!=(const Symbol& that) const { return m_id != that.m_id; }
+	bool operator<(const Symbol& that) const { return m_id != that.m_id && str() < that.str(); }
+
+private:
+	unsigned m_id;
+};
+
+// Open addressing hash index of symbols to positions in a dense vector. The symbol ids are
+// spread with Fibonacci hashing, so a lookup is mostly a single probe.
+class SymbolIndex {
+public:
+	static const std::size_t NOT_FOUND = static_cast<std::size_t>(-1);
+
+	SymbolIndex() : m_count(0), m_shift(32) {}
+
+	// position of `symbol`, NOT_FOUND if it is not indexed
+	std::size_t Find(const Symbol& symbol) const;
+	// indexes `symbol` at `position`, unless it is indexed already; returns its position
+	std::size_t Insert(const Symbol& symbol, std::size_t position);
+	void Clear();
+
+private:
+	struct Slot {
+		unsigned id; //!< 0 for a free slot, the empty symbol is never indexed
+		unsigned position;
+	};
+
+	std::size_t Probe(unsigned id) const;
+	void Grow();
+
+	std::vector<Slot> m_slots; //!< power of two sized, at most half full
+	std::size_t m_count;
+	unsigned m_shift; //!< 32 - log2 of the slot count, the hash is taken from the top bits
+};
+
+namespace std {
+	template<> struct hash<Symbol> {
+		std::size_t operator()(const Symbol& value) const { return value.id(); }
+	};
+}
+
+#endif // SYMBOL_H__
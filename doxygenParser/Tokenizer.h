@@ -0,0 +1,67 @@
+#ifndef TOKENIZER_H__
+#define TOKENIZER_H__
+
+#include "types.h"
+
+// Set of delimiter characters, tested with a table lookup. Only characters below 256 can
+// be delimiters.
+class DelimiterSet {
+public:
+	explicit DelimiterSet(const _TCHAR* delimiters) {
+		for (std::size_t i = 0; i < 256; i++) {
+			m_table[i] = false;
+		}
+		for (; *delimiters; delimiters++) {
+			if (IsByte(*delimiters)) {
+				m_table[static_cast<unsigned char>(*delimiters)] = true;
+			}
+		}
+	}
+
+	bool Contains(_TCHAR c) const { return IsByte(c) && m_table[static_cast<unsigned char>(c)]; }
+
+private:
+	static bool IsByte(_TCHAR c) { return sizeof(_TCHAR) == 1 || static_cast<unsigned long>(c) < 256; }
+
+	bool m_table[256];
+};
+
+// The non-empty tokens between the delimiters of a string, found in a single pass and
+// yielded as views into it, without allocating.
+//   for (Tokens token(type, delimiters); token.Next();) { ... token.Current() ... }
+class Tokens {
+public:
+	// `value` has to outlive the tokens, it must not be a temporary owning its string
+	Tokens(const stringRef& value, const DelimiterSet& delimiters)
+		: m_delimiters(delimiters), m_position(value.str()), m_end(value.str() + value.size()), m_begin(nullptr), m_size(0) {}
+	Tokens(const string& value, const DelimiterSet& delimiters)
+		: m_delimiters(delimiters), m_position(value.c_str()), m_end(value.c_str() + value.size()), m_begin(nullptr), m_size(0) {}
+
+	// moves to the next token, returns false if there is none
+	bool Next() {
+		while (m_position != m_end && m_delimiters.Contains(*m_position)) {
+			m_position++;
+		}
+		if (m_position == m_end) return false;
+
+		m_begin = m_position;
+		while (m_position != m_end && !m_delimiters.Contains(*m_position)) {
+			m_position++;
+		}
+		m_size = m_position - m_begin;
+		return true;
+	}
+
+	stringRef Current() const { return stringRef(m_begin, m_size); }
+
+private:
+	Tokens& operator=(const Tokens&);
+
+	const DelimiterSet& m_delimiters;
+	const _TCHAR* m_position;
+	const _TCHAR* const m_end;
+	const _TCHAR* m_begin; //!< the current token
+	std::size_t m_size;
+};
+
+#endif // TOKENIZER_H__
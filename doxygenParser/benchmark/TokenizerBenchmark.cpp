@@ -0,0 +1,165 @@
+// Times the single pass Tokens (Tokenizer.h) against the split() helpers it replaced in
+// ClassManager, on the kinds of strings GetConnections and GetUsableClasses tokenize.
+// It is a program of its own, not part of doxygenParser:
+//   g++ -std=c++11 -O2 -o tokenizerBenchmark benchmark/TokenizerBenchmark.cpp
+//   cl /EHsc /O2 benchmark\TokenizerBenchmark.cpp
+// An optional argument sets the number of rounds over the strings.
+
+#include "../types.h"
+#include "../Tokenizer.h"
+#include <chrono>
+#include <cstdlib>
+#include <sstream>
+#include <vector>
+
+namespace {
+	// the split() helpers as ClassManager had them
+	std::vector<string> split(const string &s, _TCHAR delim) {
+		std::vector<string> elems;
+		std::basic_stringstream<_TCHAR> ss(s);
+		string item;
+		while (std::getline(ss, item, delim)) {
+			elems.push_back(item);
+		}
+		return elems;
+	}
+
+	template<std::size_t Size>
+	std::vector<string> split(const string &s, const _TCHAR (&delim)[Size]) {
+		std::vector<string> elems = split(s, delim[0]);
+		for (std::size_t i = 1; i < Size; i++) {
+			std::vector<string> iElems;
+			for (const auto& item: elems) {
+				for (const auto& elem: split(item, delim[i])) {
+					iElems.push_back(elem);
+				}
+			}
+
+			elems.swap(iElems);
+		}
+		return elems;
+	}
+
+	const _TCHAR TYPE_SPLIT[] = _T(" \t&*");
+	const _TCHAR TEMPLATE_SPLIT[] = _T(",<> \t&*");
+	const _TCHAR ID_SPLIT[] = _T("::");
+	const DelimiterSet TYPE_DELIMITERS(TYPE_SPLIT);
+	const DelimiterSet TEMPLATE_DELIMITERS(TEMPLATE_SPLIT);
+	const DelimiterSet ID_DELIMITERS(_T(":"));
+
+	// direct part, template arguments and qualified name of the sample strings
+	struct Sample {
+		string directType;
+		string indirectTypes;
+		string classId;
+	};
+
+	std::vector<Sample> Samples()
+	{
+		const _TCHAR* const types[] = {
+			_T("int"),
+			_T("const Foo &"),
+			_T("Bar *"),
+			_T("const std::string &"),
+			_T("std::vector< Foo * >"),
+			_T("std::map< string, std::shared_ptr< Bar > > &"),
+			_T("const std::vector< std::pair< unsigned, const Baz * > > &"),
+			_T("std::unique_ptr< ns::detail::Node< Key, Value > >"),
+		};
+		const _TCHAR* const ids[] = {
+			_T("Foo"), _T("ns::Bar"), _T("ns::detail::Node"), _T("app::ui::widgets::Button"),
+		};
+
+		std::vector<Sample> samples;
+		for (const auto type : types) {
+			for (const auto id : ids) {
+				const string value(type);
+				const std::size_t templateDelimiter = value.find_first_of(_T('<'));
+				Sample sample;
+				sample.directType = templateDelimiter == string::npos ? value : value.substr(0, templateDelimiter);
+				sample.indirectTypes = templateDelimiter == string::npos ? string() : value.substr(templateDelimiter + 1);
+				sample.classId = id;
+				samples.push_back(sample);
+			}
+		}
+		return samples;
+	}
+
+	// The tokens of every sample, in order, by both methods. Collected once, outside the
+	// timed loops, to check that Tokens splits exactly like split().
+	std::vector<string> SplitTokens(const Sample& sample)
+	{
+		std::vector<string> tokens;
+		for (const auto& token : split(sample.directType, TYPE_SPLIT)) tokens.push_back(token);
+		for (const auto& token : split(sample.indirectTypes, TEMPLATE_SPLIT)) tokens.push_back(token);
+		for (const auto& token : split(sample.classId, ID_SPLIT)) tokens.push_back(token);
+		return tokens;
+	}
+
+	std::vector<string> TokensOf(const Sample& sample)
+	{
+		std::vector<string> tokens;
+		for (Tokens token(sample.directType, TYPE_DELIMITERS); token.Next();) tokens.push_back(string(token.Current().str(), token.Current().size()));
+		for (Tokens token(sample.indirectTypes, TEMPLATE_DELIMITERS); token.Next();) tokens.push_back(string(token.Current().str(), token.Current().size()));
+		for (Tokens token(sample.classId, ID_DELIMITERS); token.Next();) tokens.push_back(string(token.Current().str(), token.Current().size()));
+		return tokens;
+	}
+
+	// the timed loops sum up the token lengths, so the compiler cannot drop them
+	std::size_t RunSplit(const std::vector<Sample>& samples)
+	{
+		std::size_t total = 0;
+		for (const auto& sample : samples) {
+			for (const auto& token : split(sample.directType, TYPE_SPLIT)) total += token.size();
+			for (const auto& token : split(sample.indirectTypes, TEMPLATE_SPLIT)) total += token.size();
+			for (const auto& token : split(sample.classId, ID_SPLIT)) total += token.size();
+		}
+		return total;
+	}
+
+	std::size_t RunTokens(const std::vector<Sample>& samples)
+	{
+		std::size_t total = 0;
+		for (const auto& sample : samples) {
+			for (Tokens token(sample.directType, TYPE_DELIMITERS); token.Next();) total += token.Current().size();
+			for (Tokens token(sample.indirectTypes, TEMPLATE_DELIMITERS); token.Next();) total += token.Current().size();
+			for (Tokens token(sample.classId, ID_DELIMITERS); token.Next();) total += token.Current().size();
+		}
+		return total;
+	}
+
+	template<typename Run>
+	double Time(const std::vector<Sample>& samples, int rounds, Run run, std::size_t& total)
+	{
+		total = 0;
+		const auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < rounds; i++) {
+			total += run(samples);
+		}
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	const int rounds = argc > 1 ? std::atoi(argv[1]) : 2000;
+	const std::vector<Sample> samples = Samples();
+
+	for (const auto& sample : samples) {
+		const std::vector<string> expected = SplitTokens(sample);
+		const std::vector<string> actual = TokensOf(sample);
+		if (expected != actual) {
+			tcout << _T("token mismatch: ") << sample.directType << _T('<') << sample.indirectTypes << _T(" / ") << sample.classId << std::endl;
+			return 1;
+		}
+	}
+
+	std::size_t splitTotal = 0, tokensTotal = 0;
+	const double splitTime = Time(samples, rounds, RunSplit, splitTotal);
+	const double tokensTime = Time(samples, rounds, RunTokens, tokensTotal);
+
+	std::cout << samples.size() << " strings x " << rounds << " rounds" << std::endl;
+	std::cout << "split():  " << splitTime << " ms" << std::endl;
+	std::cout << "Tokens:   " << tokensTime << " ms (" << splitTime / tokensTime << "x)" << std::endl;
+	return splitTotal == tokensTotal ? 0 : 1;
+}
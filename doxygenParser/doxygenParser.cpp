@@ -6,26 +6,29 @@
 #include <iostream>
 #include "FileSystem.h"
 #include "ClassManager.h"
+#include "DoxygenReader.h"
+#include "Cache.h"
+#include <memory>
 
 void printElement(const Element& element, const int indent = 0) {
 	const string indentation(indent*2, _T(' '));
-	std::wcout << indentation << _T("node: ") << element.Name().str() << std::endl;
+	tcout << indentation << _T("node: ") << element.Name().str() << std::endl;
 
 	if (element.Text()) {
-		std::wcout << indentation << _T("text: ") << element.Text().str() << std::endl;
+		tcout << indentation << _T("text: ") << element.Text().str() << std::endl;
 	}
 
-	auto& attributes = element.Attributes();
+	const AttributeRange attributes = element.Attributes();
 	if (!attributes.empty()) {
-		std::wcout << indentation << _T("attributes: ") << std::endl;
+		tcout << indentation << _T("attributes: ") << std::endl;
 		for (const auto& attribute: attributes) {
-			std::wcout << indentation << _T(" ") << attribute.first.str() << _T(": ") << attribute.second.str() << std::endl;
+			tcout << indentation << _T(" ") << attribute.name() << _T(": ") << attribute.value() << std::endl;
 		}
 	}
 
-	auto subitems = element.Elements();
+	const ElementRange subitems = element.Elements();
 	if (!subitems.empty()) {
-		std::wcout << indentation << _T("subitems: ") << std::endl;
+		tcout << indentation << _T("subitems: ") << std::endl;
 		for (const auto& e: subitems) {
 			printElement(e, indent + 1);
 		}
@@ -33,62 +36,57 @@ void printElement(const Element& element, const int indent = 0) {
 }
 
 
-int _tmain(int argc, _TCHAR* argv[])
+int Run(int argc, _TCHAR* argv[])
 {
 
 	if (argc >= 2) {
 
 		const _TCHAR* outputDir = argc > 2 ? argv[2] : argv[1];
-		FileSystem::CreateRecursiveDirectory(string(outputDir) + _T("\\"));
+		FileSystem::CreateRecursiveDirectory(FileSystem::Combine(outputDir, _T("")));
 		ClassManager classManager(outputDir);
 
-		std::wcout << _T("Fetching classes...") << std::endl;
-		for (const auto& file : FileSystem::GetFiles(string(argv[1]), _T("xml"))) {
-			auto fileContent = readXMLFromFile(file.c_str());
-
-			using namespace rapidxml;
-			xml_document<_TCHAR> doc;
-			doc.parse<0>(fileContent.data());
-
-			Element doxygenNode = Element(doc.first_node(_T("doxygen")));
-			for (const auto& def : doxygenNode.Elements(_T("compounddef"))) {
-				if (def.GetAttribute(_T("language")) == _T("C++")) {
-					classManager.ProcessDef(def);
-				}
-			}
+		// an optional cache directory makes reruns skip the unchanged input files
+		std::unique_ptr<Cache> cache;
+		if (argc > 3) {
+			FileSystem::CreateRecursiveDirectory(FileSystem::Combine(argv[3], _T("")));
+			cache.reset(new Cache(argv[3]));
 		}
 
-		std::wcout << _T("Running classes analysis...") << std::endl;
-		classManager.Initialize();
+		DoxygenReader reader(argv[1], cache.get());
 
-		std::wcout << _T("Running source files analysis...") << std::endl;
-		const auto files = FileSystem::GetFiles(string(argv[1]), _T("xml"));
+		tcout << _T("Fetching classes...") << std::endl;
+		reader.ReadDefinitions(classManager);
 
-		#pragma omp parallel for
-		for (int i = 0; i < files.size(); i++) {
-			const auto& file = files[i];
-			auto fileContent = readXMLFromFile(file.c_str());
-
-			using namespace rapidxml;
-			xml_document<_TCHAR> doc;
-			doc.parse<0>(fileContent.data());
+		tcout << _T("Running classes analysis...") << std::endl;
+		classManager.Initialize();
 
-			Element doxygenNode = Element(doc.first_node(_T("doxygen")));
-			for (const auto& def : doxygenNode.Elements(_T("compounddef"))) {
-				if (def.GetAttribute(_T("language")) == _T("C++") && def.GetAttribute(_T("kind")) == _T("file")) {
-					classManager.ProcessFileDef(def);
-				}
-			}
-		}
+		tcout << _T("Running source files analysis...") << std::endl;
+		reader.ProcessFiles(classManager);
 
-		std::wcout << _T("Writing json output...") << std::endl;
+		tcout << _T("Writing json output...") << std::endl;
 		classManager.WriteClassesJson();
 		classManager.WriteNamespaceJsons();
 		classManager.WriteSingleClassJsons();
 
-		std::wcout << _T("Done.") << std::endl;
+		if (cache) {
+			cache->Save();
+			tcout << cache->Hits() << _T(" files taken from the cache, ") << cache->Misses() << _T(" parsed.") << std::endl;
+		}
+
+		tcout << _T("Done.") << std::endl;
 
 	}
 	return 0;
 }
 
+#ifdef _WIN32
+int _tmain(int argc, _TCHAR* argv[])
+{
+	return Run(argc, argv);
+}
+#else
+int main(int argc, char* argv[])
+{
+	return Run(argc, argv);
+}
+#endif
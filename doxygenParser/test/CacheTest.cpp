@@ -0,0 +1,138 @@
+// Checks that the usages cached for a file compound survive changes to the model which
+// ProcessFileDef does not read for it: the body of a method in another file is edited, and
+// only the files of that method are parsed again. It is a program of its own, built with
+// the sources of doxygenParser but its main:
+//   g++ -std=c++11 -fopenmp -o cacheTest test/CacheTest.cpp Cache.cpp ClassManager.cpp DoxygenReader.cpp
+//       FileSystem.cpp JsonWriter.cpp Keyword.cpp ScopeIndex.cpp Symbol.cpp xml/*.cpp
+// The argument is a scratch directory, cacheTest in the working directory by default.
+
+#include "../Cache.h"
+#include "../ClassManager.h"
+#include "../DoxygenReader.h"
+#include "../FileSystem.h"
+#include <fstream>
+
+namespace {
+	int failures = 0;
+
+	void Check(bool condition, const char* what)
+	{
+		if (!condition) {
+			std::cout << "FAILED: " << what << std::endl;
+			failures++;
+		}
+	}
+
+	void WriteFile(const string& filename, const std::string& content)
+	{
+		std::ofstream file(filename.c_str(), std::ios::binary | std::ios::trunc);
+		file << content;
+	}
+
+	// class compound with a member and a method, whose body is at the given lines of `file`
+	std::string ClassCompound(const std::string& name, const std::string& file, int bodyStart, int bodyEnd)
+	{
+		return
+			"<?xml version='1.0' encoding='UTF-8' standalone='no'?>\n"
+			"<doxygen version=\"1.8.6\">\n"
+			"  <compounddef id=\"class" + name + "\" kind=\"class\" language=\"C++\" prot=\"public\">\n"
+			"    <compoundname>" + name + "</compoundname>\n"
+			"    <sectiondef kind=\"public-func\">\n"
+			"      <memberdef kind=\"function\" id=\"class" + name + "_1run\" prot=\"public\" static=\"no\" const=\"no\" explicit=\"no\" inline=\"no\" virtual=\"non-virtual\">\n"
+			"        <type>void</type><definition>void " + name + "::run</definition><argsstring>()</argsstring><name>run</name>\n"
+			"        <briefdescription></briefdescription>\n"
+			"        <location file=\"" + file + "\" line=\"" + std::to_string(bodyStart) + "\" bodyfile=\"" + file + "\" bodystart=\"" + std::to_string(bodyStart) + "\" bodyend=\"" + std::to_string(bodyEnd) + "\"/>\n"
+			"      </memberdef>\n"
+			"    </sectiondef>\n"
+			"    <sectiondef kind=\"private-attrib\">\n"
+			"      <memberdef kind=\"variable\" id=\"class" + name + "_1count\" prot=\"private\" static=\"no\" mutable=\"no\">\n"
+			"        <type>int</type><definition>int " + name + "::count</definition><argsstring></argsstring><name>count</name>\n"
+			"        <briefdescription></briefdescription>\n"
+			"        <location file=\"" + name + ".h\" line=\"3\"/>\n"
+			"      </memberdef>\n"
+			"    </sectiondef>\n"
+			"    <briefdescription></briefdescription>\n"
+			"    <location file=\"" + name + ".h\" line=\"1\"/>\n"
+			"  </compounddef>\n"
+			"</doxygen>\n";
+	}
+
+	// file compound listing `lines`, numbered from 1
+	std::string FileCompound(const std::string& id, const std::string& file, const std::vector<std::string>& lines)
+	{
+		std::string listing;
+		for (std::size_t i = 0; i < lines.size(); i++) {
+			listing += "<codeline lineno=\"" + std::to_string(i + 1) + "\"><highlight class=\"normal\">" + lines[i] + "</highlight></codeline>\n";
+		}
+		return
+			"<?xml version='1.0' encoding='UTF-8' standalone='no'?>\n"
+			"<doxygen version=\"1.8.6\">\n"
+			"  <compounddef id=\"" + id + "\" kind=\"file\" language=\"C++\">\n"
+			"    <compoundname>" + file + "</compoundname>\n"
+			"    <programlisting>\n" + listing + "    </programlisting>\n"
+			"    <location file=\"" + file + "\"/>\n"
+			"  </compounddef>\n"
+			"</doxygen>\n";
+	}
+
+	// one run of the tool on `input`, as doxygenParser does it
+	void Run(const string& input, const string& output, const string& cacheDir, unsigned& hits, unsigned& misses)
+	{
+		ClassManager classManager(output);
+		Cache cache(cacheDir);
+		DoxygenReader reader(input, &cache);
+		reader.ReadDefinitions(classManager);
+		classManager.Initialize();
+		reader.ProcessFiles(classManager);
+		cache.Save();
+		hits = cache.Hits();
+		misses = cache.Misses();
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	const string root = argc > 1 ? string(argv[1], argv[1] + std::char_traits<char>::length(argv[1])) : string(_T("cacheTest"));
+	const string input = FileSystem::Combine(root, _T("input"));
+	const string output = FileSystem::Combine(root, _T("output"));
+	const string cacheDir = FileSystem::Combine(root, _T("cache"));
+	FileSystem::CreateRecursiveDirectory(FileSystem::Combine(input, _T("")));
+	FileSystem::CreateRecursiveDirectory(FileSystem::Combine(output, _T("")));
+	FileSystem::CreateRecursiveDirectory(FileSystem::Combine(cacheDir, _T("")));
+	WriteFile(FileSystem::Combine(cacheDir, _T("doxygenParser.cache")), std::string()); // no cache of an earlier test run
+
+	// Alpha::run in alpha.cpp and Beta::run in beta.cpp use each other
+	const std::vector<std::string> alphaLines = { "void Alpha::run()", "{", "  Beta other;", "  count++;", "}" };
+	const std::vector<std::string> betaLines = { "void Beta::run()", "{", "  Alpha other;", "  run();", "}" };
+	WriteFile(FileSystem::Combine(input, _T("classAlpha.xml")), ClassCompound("Alpha", "alpha.cpp", 1, 5));
+	WriteFile(FileSystem::Combine(input, _T("classBeta.xml")), ClassCompound("Beta", "beta.cpp", 1, 5));
+	WriteFile(FileSystem::Combine(input, _T("alpha_8cpp.xml")), FileCompound("alpha_8cpp", "alpha.cpp", alphaLines));
+	WriteFile(FileSystem::Combine(input, _T("beta_8cpp.xml")), FileCompound("beta_8cpp", "beta.cpp", betaLines));
+
+	unsigned hits = 0, misses = 0;
+	Run(input, output, cacheDir, hits, misses);
+	Check(hits == 0 && misses == 4, "the first run parses every file");
+
+	Run(input, output, cacheDir, hits, misses);
+	Check(hits == 4 && misses == 0, "an unchanged rerun takes every file from the cache");
+
+	// the body of Alpha::run grows by a line, which moves its body end
+	std::vector<std::string> editedLines = alphaLines;
+	editedLines.insert(editedLines.begin() + 3, "  count--;");
+	WriteFile(FileSystem::Combine(input, _T("classAlpha.xml")), ClassCompound("Alpha", "alpha.cpp", 1, 6));
+	WriteFile(FileSystem::Combine(input, _T("alpha_8cpp.xml")), FileCompound("alpha_8cpp", "alpha.cpp", editedLines));
+
+	Run(input, output, cacheDir, hits, misses);
+	Check(misses == 2, "only the class and the file of the edited method are parsed again");
+	Check(hits == 2, "the class and the file without the edited method are taken from the cache");
+
+	// a new class changes the usable class names of every file
+	WriteFile(FileSystem::Combine(input, _T("classGamma.xml")), ClassCompound("Gamma", "gamma.cpp", 1, 2));
+	Run(input, output, cacheDir, hits, misses);
+	Check(misses == 3 && hits == 2, "a new class name invalidates the usages of every file");
+
+	if (failures == 0) {
+		std::cout << "ok" << std::endl;
+	}
+	return failures == 0 ? 0 : 1;
+}
@@ -1,36 +1,94 @@
 #ifndef TYPES_H__
 #define TYPES_H__
 
+#ifdef _WIN32
 #include <tchar.h>
+#else
+// everywhere else the model is built on UTF-8 encoded narrow strings
+typedef char _TCHAR;
+#define _T(x) x
+#endif
+
+// Size of the blocks the rapidxml pools grow by. The pools are recycled between the parsed
+// files (XmlDocument), so big blocks cost little; define it in the build to tune it.
+#ifndef RAPIDXML_DYNAMIC_POOL_SIZE
+#define RAPIDXML_DYNAMIC_POOL_SIZE (512 * 1024)
+#endif
+
 #include "../rapidxml/rapidxml.hpp"
 #include <string>
+#include <functional>
+#include <iostream>
+
+#if defined(_WIN32) && defined(_UNICODE)
+#define tcout std::wcout
+#else
+#define tcout std::cout
+#endif
 
 typedef std::basic_string<_TCHAR> string;
 typedef rapidxml::xml_node<_TCHAR> Node;
 typedef rapidxml::xml_attribute<_TCHAR> Attribute;
 
+// View of a string with its length, so sizes and comparisons need neither strlen nor
+// temporary strings. Mostly it points into the parsed documents. Constructed from a string
+// it is a view of it as well, which must not outlive the string; only a temporary string
+// is moved into the stringRef and kept by it.
 struct stringRef {
-	stringRef() : m_str(nullptr), m_owner(false) {}
-	stringRef(const _TCHAR* str) : m_str(str), m_owner(false) {}
-	stringRef(const stringRef& that) : m_buffer(that.m_buffer), m_owner(that.m_owner), m_str(m_owner ? m_buffer.c_str() : that.m_str) {}
-	stringRef(stringRef&& that) : m_buffer(std::move(that.m_buffer)), m_str(that.m_str), m_owner(that.m_owner) {}
-	stringRef(const string& that) : m_buffer(that), m_str(m_buffer.c_str()), m_owner(true) {}
-	stringRef(string&& that) : m_buffer(std::move(that)), m_str(m_buffer.c_str()), m_owner(true) {}
+	typedef std::char_traits<_TCHAR> traits;
+
+	stringRef() : m_owner(false), m_str(nullptr), m_size(0) {}
+	stringRef(const _TCHAR* str) : m_owner(false), m_str(str), m_size(str ? traits::length(str) : 0) {}
+	stringRef(const _TCHAR* str, std::size_t size) : m_owner(false), m_str(str), m_size(size) {}
+	stringRef(const stringRef& that) : m_owner(that.m_owner), m_buffer(that.m_buffer), m_str(m_owner ? m_buffer.c_str() : that.m_str), m_size(that.m_size) {}
+	stringRef(stringRef&& that) : m_owner(that.m_owner), m_buffer(std::move(that.m_buffer)), m_str(m_owner ? m_buffer.c_str() : that.m_str), m_size(that.m_size) {}
+	stringRef(const string& that) : m_owner(false), m_str(that.c_str()), m_size(that.size()) {}
+	stringRef(string&& that) : m_owner(true), m_buffer(std::move(that)), m_str(m_buffer.c_str()), m_size(m_buffer.size()) {}
 
 	const _TCHAR* str() const { return m_str ? m_str : _T(""); }
-	std::size_t size() const { return m_str ? string(str()).size() : 0; }
-	operator bool() const { return m_str != nullptr && m_str[0] != _T('\0'); }
-	bool operator >(const _TCHAR* that) const { return string(str()) > string(that); }
-	bool operator >=(const _TCHAR* that) const { return string(str()) >= string(that); }
-	bool operator <(const _TCHAR* that) const { return string(str()) < string(that); }
-	bool operator <=(const _TCHAR* that) const { return string(str()) <= string(that); }
-	bool operator ==(const _TCHAR* that) const { return string(str()) == string(that); }
-	bool operator !=(const _TCHAR* that) const { return !operator==(that); }
+	std::size_t size() const { return m_size; }
+	operator bool() const { return m_size != 0; }
+
+	bool operator >(const _TCHAR* that) const { return compare(that) > 0; }
+	bool operator >=(const _TCHAR* that) const { return compare(that) >= 0; }
+	bool operator <(const _TCHAR* that) const { return compare(that) < 0; }
+	bool operator <=(const _TCHAR* that) const { return compare(that) <= 0; }
+	bool operator ==(const _TCHAR* that) const { return compare(that) == 0; }
+	bool operator !=(const _TCHAR* that) const { return compare(that) != 0; }
+	bool operator ==(const string& that) const { return compare(that.c_str(), that.size()) == 0; }
+	bool operator !=(const string& that) const { return compare(that.c_str(), that.size()) != 0; }
+	bool operator ==(const stringRef& that) const { return compare(that.m_str, that.m_size) == 0; }
+	bool operator !=(const stringRef& that) const { return compare(that.m_str, that.m_size) != 0; }
+	bool operator <(const stringRef& that) const { return compare(that.m_str, that.m_size) < 0; }
+
+	// FNV-1a over the characters
+	std::size_t hash() const {
+		unsigned long long result = 0xcbf29ce484222325ULL;
+		for (std::size_t i = 0; i < m_size; i++) {
+			result = (result ^ static_cast<unsigned long long>(m_str[i])) * 0x100000001b3ULL;
+		}
+		return static_cast<std::size_t>(result);
+	}
+
+private:
+	int compare(const _TCHAR* that) const { return compare(that, that ? traits::length(that) : 0); }
+	int compare(const _TCHAR* that, std::size_t size) const {
+		const int result = traits::compare(str(), that ? that : _T(""), m_size < size ? m_size : size);
+		if (result != 0) return result;
+		return m_size < size ? -1 : m_size > size ? 1 : 0;
+	}
 
 private:
 	const bool m_owner; // true if keeping the string in m_buffer
 	const string m_buffer;
 	const _TCHAR* const m_str;
+	const std::size_t m_size;
 };
 
+namespace std {
+	template<> struct hash<stringRef> {
+		std::size_t operator()(const stringRef& value) const { return value.hash(); }
+	};
+}
+
 #endif // TYPES_H__
@@ -0,0 +1,57 @@
+#include "XmlDocument.h"
+#include <cstdlib>
+#include <new>
+
+#ifdef _MSC_VER
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL __thread
+#endif
+
+namespace {
+	const std::size_t MAX_CACHED_BYTES = 64 * RAPIDXML_DYNAMIC_POOL_SIZE; //!< per thread
+
+	struct Block {
+		Block* next; //!< while cached
+		std::size_t size;
+	};
+
+	THREAD_LOCAL Block* cachedBlocks = nullptr;
+	THREAD_LOCAL std::size_t cachedBytes = 0;
+}
+
+void* XmlDocument::Allocate(std::size_t size)
+{
+	// the pool blocks are all of the same size, except for single allocations bigger than that
+	Block* block = cachedBlocks;
+	if (block && block->size >= size) {
+		cachedBlocks = block->next;
+		cachedBytes -= block->size;
+	} else {
+		block = static_cast<Block*>(std::malloc(sizeof(Block) + size));
+		if (!block) throw std::bad_alloc();
+		block->size = size;
+	}
+	return block + 1;
+}
+
+void XmlDocument::Release(void* memory)
+{
+	Block* block = static_cast<Block*>(memory) - 1;
+	if (cachedBytes + block->size <= MAX_CACHED_BYTES) {
+		block->next = cachedBlocks;
+		cachedBlocks = block;
+		cachedBytes += block->size;
+	} else {
+		std::free(block);
+	}
+}
+
+void XmlDocument::ReleaseCachedBlocks()
+{
+	while (Block* block = cachedBlocks) {
+		cachedBlocks = block->next;
+		std::free(block);
+	}
+	cachedBytes = 0;
+}
@@ -0,0 +1,24 @@
+#ifndef XML_DOCUMENT_H__
+#define XML_DOCUMENT_H__
+
+#include "../types.h"
+
+// rapidxml document meant to be reused for one file after the other. Clearing it hands
+// the dynamic pool blocks to a cache of the calling thread, where the next parse on that
+// thread takes them from, instead of going through malloc and free for every file.
+class XmlDocument : public rapidxml::xml_document<_TCHAR> {
+public:
+	XmlDocument() { set_allocator(Allocate, Release); }
+
+	// frees the pool blocks cached for the calling thread
+	static void ReleaseCachedBlocks();
+
+private:
+	XmlDocument(const XmlDocument&);
+	XmlDocument& operator=(const XmlDocument&);
+
+	static void* Allocate(std::size_t size);
+	static void Release(void* memory);
+};
+
+#endif // XML_DOCUMENT_H__
@@ -0,0 +1,169 @@
+#include "XmlFile.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+void XmlFile::Assign(const char* content, std::size_t size)
+{
+	m_buffer.resize(size + 1);
+	for (std::size_t i = 0; i < size; i++) {
+		m_buffer[i] = static_cast<_TCHAR>(static_cast<unsigned char>(content[i]));
+	}
+	m_buffer[size] = _T('\0');
+
+	m_data = m_buffer.data();
+	m_size = size;
+}
+
+void XmlFile::Truncate(std::size_t size)
+{
+	if (size < m_size) {
+		m_size = size;
+		m_data[m_size] = _T('\0');
+	}
+}
+
+void XmlFile::Prefetch() const
+{
+	if (!m_view) return;
+
+	const std::size_t pageSize = 4096;
+	const volatile char* content = static_cast<const char*>(m_view);
+	for (std::size_t i = 0; i < m_size; i += pageSize) {
+		content[i];
+	}
+}
+
+#ifdef _WIN32
+
+XmlFile::XmlFile(const stringRef& filename, unsigned long long maxSize) : m_data(nullptr), m_size(0), m_view(nullptr), m_viewSize(0), m_oversized(false)
+{
+	HANDLE file = CreateFile(filename.str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE) return;
+
+	LARGE_INTEGER fileSize;
+	if (GetFileSizeEx(file, &fileSize)) {
+		const std::size_t size = static_cast<std::size_t>(fileSize.QuadPart);
+		if (static_cast<unsigned long long>(fileSize.QuadPart) > maxSize) {
+			m_oversized = true;
+		} else if (size == 0) {
+			Assign("", 0);
+		} else if (HANDLE mapping = CreateFileMapping(file, NULL, PAGE_WRITECOPY, 0, 0, NULL)) {
+			void* view = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+			CloseHandle(mapping); // the view keeps the mapping alive
+			if (view) {
+				SYSTEM_INFO info;
+				GetSystemInfo(&info);
+
+				// the zero filled rest of the last page serves as the terminator
+				if (sizeof(_TCHAR) == 1 && size % info.dwPageSize != 0) {
+					m_view = view;
+					m_viewSize = size;
+					m_data = reinterpret_cast<_TCHAR*>(view);
+					m_size = size;
+				} else {
+					Assign(static_cast<const char*>(view), size);
+					UnmapViewOfFile(view);
+				}
+			}
+		}
+	}
+	CloseHandle(file);
+}
+
+XmlFile::~XmlFile()
+{
+	if (m_view) {
+		UnmapViewOfFile(m_view);
+	}
+}
+
+std::size_t XmlFile::ReadHead(const stringRef& filename, char* buffer, std::size_t size)
+{
+	HANDLE file = CreateFile(filename.str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) return 0;
+
+	std::size_t total = 0;
+	DWORD read = 0;
+	while (total < size && ReadFile(file, buffer + total, static_cast<DWORD>(size - total), &read, NULL) && read > 0) {
+		total += read;
+	}
+	CloseHandle(file);
+	return total;
+}
+
+#else
+
+XmlFile::XmlFile(const stringRef& filename, unsigned long long maxSize) : m_data(nullptr), m_size(0), m_view(nullptr), m_viewSize(0), m_oversized(false)
+{
+	const int file = open(filename.str(), O_RDONLY);
+	if (file < 0) return;
+
+	struct stat info;
+	if (fstat(file, &info) == 0) {
+		const std::size_t size = static_cast<std::size_t>(info.st_size);
+		if (static_cast<unsigned long long>(info.st_size) > maxSize) {
+			m_oversized = true;
+		} else if (size == 0) {
+			Assign("", 0);
+		} else {
+			posix_fadvise(file, 0, 0, POSIX_FADV_SEQUENTIAL);
+			posix_fadvise(file, 0, 0, POSIX_FADV_WILLNEED);
+
+			// Reserve at least one byte more than the file size, so the terminator lands
+			// in zero filled memory even if the file ends exactly on a page boundary.
+			const std::size_t page = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+			const std::size_t viewSize = (size / page + 1) * page;
+			void* view = mmap(nullptr, viewSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+			if (view != MAP_FAILED) {
+				if (mmap(view, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, file, 0) != MAP_FAILED) {
+					madvise(view, size, MADV_SEQUENTIAL);
+					madvise(view, size, MADV_WILLNEED);
+
+					if (sizeof(_TCHAR) == 1) {
+						m_view = view;
+						m_viewSize = viewSize;
+						m_data = reinterpret_cast<_TCHAR*>(view);
+						m_size = size;
+					} else {
+						Assign(static_cast<const char*>(view), size);
+						munmap(view, viewSize);
+					}
+				} else {
+					munmap(view, viewSize);
+				}
+			}
+		}
+	}
+	close(file);
+}
+
+XmlFile::~XmlFile()
+{
+	if (m_view) {
+		munmap(m_view, m_viewSize);
+	}
+}
+
+std::size_t XmlFile::ReadHead(const stringRef& filename, char* buffer, std::size_t size)
+{
+	const int file = open(filename.str(), O_RDONLY);
+	if (file < 0) return 0;
+
+	std::size_t total = 0;
+	while (total < size) {
+		const ssize_t read = pread(file, buffer + total, size - total, total);
+		if (read <= 0) break;
+		total += static_cast<std::size_t>(read);
+	}
+	close(file);
+	return total;
+}
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef XML_FILE_H__
+#define XML_FILE_H__
+
+#include "../types.h"
+#include <vector>
+
+// Zero terminated content of an input file, ready for rapidxml in-situ parsing.
+// The file is mapped copy-on-write, so the parser may write its string terminators
+// straight into the mapping. Only when the mapped bytes can not be used as they are
+// (wide _TCHAR build) is the content converted once into an owned buffer.
+class XmlFile {
+public:
+	// a file bigger than `maxSize` bytes is not loaded, it is Oversized instead
+	explicit XmlFile(const stringRef& filename, unsigned long long maxSize = ~0ULL);
+	~XmlFile();
+
+	_TCHAR* Data() { return m_data; }
+	std::size_t Size() const { return m_size; }
+
+	// shortens the content to `size` characters, e.g. after parts were cut out of it
+	void Truncate(std::size_t size);
+
+	// faults the whole mapped content in, so a later parse does not wait for the disk
+	void Prefetch() const;
+
+	// whether the file was too big to be loaded, so it has to be read otherwise
+	bool Oversized() const { return m_oversized; }
+
+	// reads the first (at most) `size` bytes of a file without mapping it, returns their count
+	static std::size_t ReadHead(const stringRef& filename, char* buffer, std::size_t size);
+
+	operator bool() const { return m_data != nullptr; }
+
+private:
+	XmlFile(const XmlFile&);
+	XmlFile& operator=(const XmlFile&);
+
+	void Assign(const char* content, std::size_t size);
+
+private:
+	_TCHAR* m_data;
+	std::size_t m_size;
+	std::vector<_TCHAR> m_buffer; //!< owned content if the mapping could not be used in-situ
+	void* m_view; //!< mapped view of the file
+	std::size_t m_viewSize;
+	bool m_oversized;
+};
+
+#endif // XML_FILE_H__
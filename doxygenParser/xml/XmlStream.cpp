@@ -0,0 +1,303 @@
+#include "XmlStream.h"
+#include <algorithm>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+	const std::size_t WINDOW_SIZE = 1024 * 1024; //!< characters read from the file at once
+}
+
+#ifdef _WIN32
+
+XmlStream::XmlStream(const stringRef& filename) : m_open(false), m_size(0), m_file(INVALID_HANDLE_VALUE), m_position(0),
+	m_type(OTHER), m_atElement(false), m_leaving(false)
+{
+	m_file = CreateFile(filename.str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (m_file == INVALID_HANDLE_VALUE) return;
+
+	LARGE_INTEGER fileSize;
+	if (GetFileSizeEx(m_file, &fileSize)) {
+		m_size = static_cast<unsigned long long>(fileSize.QuadPart);
+		m_open = true;
+	}
+}
+
+XmlStream::~XmlStream()
+{
+	if (m_file != INVALID_HANDLE_VALUE) {
+		CloseHandle(m_file);
+	}
+}
+
+bool XmlStream::Fill()
+{
+	if (!m_open) return false;
+
+	m_bytes.resize(WINDOW_SIZE);
+	DWORD read = 0;
+	if (!ReadFile(m_file, m_bytes.data(), static_cast<DWORD>(m_bytes.size()), &read, NULL) || read == 0) {
+		m_open = false;
+		return false;
+	}
+
+	m_window.resize(read);
+	std::transform(m_bytes.begin(), m_bytes.begin() + read, m_window.begin(), [](char c) { return static_cast<_TCHAR>(static_cast<unsigned char>(c)); });
+	m_position = 0;
+	if (m_observer) {
+		m_observer(m_window.data(), m_window.size());
+	}
+	return true;
+}
+
+#else
+
+XmlStream::XmlStream(const stringRef& filename) : m_open(false), m_size(0), m_file(-1), m_position(0),
+	m_type(OTHER), m_atElement(false), m_leaving(false)
+{
+	m_file = open(filename.str(), O_RDONLY);
+	if (m_file < 0) return;
+
+	struct stat info;
+	if (fstat(m_file, &info) == 0) {
+		posix_fadvise(m_file, 0, 0, POSIX_FADV_SEQUENTIAL);
+		m_size = static_cast<unsigned long long>(info.st_size);
+		m_open = true;
+	}
+}
+
+XmlStream::~XmlStream()
+{
+	if (m_file >= 0) {
+		close(m_file);
+	}
+}
+
+bool XmlStream::Fill()
+{
+	if (!m_open) return false;
+
+	// the file is read straight into the window, unless the characters are to be widened
+	m_window.resize(WINDOW_SIZE);
+	m_bytes.resize(sizeof(_TCHAR) == 1 ? 0 : WINDOW_SIZE);
+	char* const buffer = sizeof(_TCHAR) == 1 ? reinterpret_cast<char*>(m_window.data()) : m_bytes.data();
+	ssize_t read;
+	do {
+		read = ::read(m_file, buffer, WINDOW_SIZE);
+	} while (read < 0 && errno == EINTR);
+	if (read <= 0) {
+		m_window.clear();
+		m_open = false;
+		return false;
+	}
+
+	m_window.resize(static_cast<std::size_t>(read));
+	if (sizeof(_TCHAR) != 1) {
+		std::transform(m_bytes.begin(), m_bytes.begin() + read, m_window.begin(), [](char c) { return static_cast<_TCHAR>(static_cast<unsigned char>(c)); });
+	}
+	m_position = 0;
+	if (m_observer) {
+		m_observer(m_window.data(), m_window.size());
+	}
+	return true;
+}
+
+#endif
+
+bool XmlStream::EndsWith(const _TCHAR* suffix) const
+{
+	const std::size_t size = std::char_traits<_TCHAR>::length(suffix);
+	return m_markup.size() >= size && m_markup.compare(m_markup.size() - size, size, suffix) == 0;
+}
+
+bool XmlStream::ReadMarkup(string* text)
+{
+	typedef std::char_traits<_TCHAR> traits;
+
+	// the text up to the markup
+	for (;;) {
+		const _TCHAR* const begin = m_window.data() + m_position;
+		const std::size_t available = m_window.size() - m_position;
+		const _TCHAR* const found = available ? traits::find(begin, available, _T('<')) : nullptr;
+		if (found) {
+			if (text) {
+				text->append(begin, found);
+			}
+			m_position += found - begin + 1;
+			break;
+		}
+		if (text) {
+			text->append(begin, available);
+		}
+		m_position = m_window.size();
+		if (!Fill()) return false;
+	}
+
+	m_markup.assign(1, _T('<'));
+	_TCHAR c;
+	if (!Get(c)) return false;
+	m_markup.push_back(c);
+
+	if (c == _T('/') || c == _T('?') || c == _T('!')) {
+		m_type = c == _T('/') ? END_TAG : OTHER;
+		const _TCHAR* end = _T(">");
+		std::size_t minSize = 3;
+		if (c == _T('?')) {
+			end = _T("?>");
+			minSize = 4;
+		}
+		while (Get(c)) {
+			m_markup.push_back(c);
+			if (m_markup.size() == 4 && EndsWith(_T("<!--"))) {
+				end = _T("-->");
+				minSize = 7;
+			} else if (m_markup.size() == 9 && EndsWith(_T("<![CDATA["))) {
+				end = _T("]]>");
+				minSize = 12;
+			}
+			if (c == _T('>') && m_markup.size() >= minSize && EndsWith(end)) return true;
+		}
+		return false;
+	}
+
+	// start tag, '>' may appear in the quoted attribute values
+	_TCHAR quote = 0;
+	while (Get(c)) {
+		m_markup.push_back(c);
+		if (quote) {
+			if (c == quote) {
+				quote = 0;
+			}
+		} else if (c == _T('"') || c == _T('\'')) {
+			quote = c;
+		} else if (c == _T('>')) {
+			m_type = m_markup[m_markup.size() - 2] == _T('/') ? EMPTY_TAG : START_TAG;
+			return true;
+		}
+	}
+	return false;
+}
+
+bool XmlStream::Next()
+{
+	if (m_atElement) {
+		Skip();
+	}
+	if (m_leaving) {
+		m_leaving = false;
+		return false;
+	}
+
+	while (ReadMarkup(nullptr)) {
+		switch (m_type) {
+		case START_TAG:
+		case EMPTY_TAG:
+			m_atElement = true;
+			return true;
+		case END_TAG:
+			return false;
+		default:
+			break;
+		}
+	}
+	return false;
+}
+
+stringRef XmlStream::Name() const
+{
+	if (!m_atElement) return stringRef();
+
+	std::size_t end = 1;
+	while (end < m_markup.size() && !isSpace(m_markup[end]) && m_markup[end] != _T('/') && m_markup[end] != _T('>')) {
+		end++;
+	}
+	return stringRef(m_markup.c_str() + 1, end - 1);
+}
+
+Element XmlStream::Tag()
+{
+	if (!m_atElement) return nullptr;
+
+	m_text = m_markup;
+	if (m_type == START_TAG) {
+		m_text.insert(m_text.size() - 1, 1, _T('/'));
+	}
+	m_document.clear();
+	m_document.parse<0>(&m_text[0]);
+	return m_document.first_node();
+}
+
+void XmlStream::Enter()
+{
+	if (!m_atElement) return;
+
+	m_atElement = false;
+	m_leaving = m_type == EMPTY_TAG;
+}
+
+void XmlStream::Skip()
+{
+	if (!m_atElement) return;
+
+	m_atElement = false;
+	int depth = m_type == START_TAG ? 1 : 0;
+	while (depth > 0 && ReadMarkup(nullptr)) {
+		if (m_type == START_TAG) {
+			depth++;
+		} else if (m_type == END_TAG) {
+			depth--;
+		}
+	}
+}
+
+Element XmlStream::Read(const std::vector<string>& skipped, const std::vector<string>& kept)
+{
+	if (!m_atElement) return nullptr;
+
+	m_text = m_markup;
+	int depth = m_type == START_TAG ? 1 : 0;
+	int keptDepth = 0; //!< depth inside the outermost kept element, 0 outside of any
+	m_atElement = false;
+	while (depth > 0 && ReadMarkup(&m_text)) {
+		if (m_type == START_TAG || m_type == EMPTY_TAG) {
+			m_atElement = true;
+			const stringRef name = Name();
+			const auto named = [&name](const string& item) { return name == item; };
+			if (!keptDepth && std::find_if(skipped.begin(), skipped.end(), named) != skipped.end()) {
+				Skip();
+				continue;
+			}
+			m_atElement = false;
+			if (m_type == START_TAG) {
+				depth++;
+				if (!keptDepth && std::find_if(kept.begin(), kept.end(), named) != kept.end()) {
+					keptDepth = depth;
+				}
+			}
+		} else if (m_type == END_TAG) {
+			if (depth == keptDepth) {
+				keptDepth = 0;
+			}
+			depth--;
+		}
+		m_text += m_markup;
+	}
+
+	m_document.clear();
+	m_document.parse<0>(&m_text[0]);
+	return m_document.first_node();
+}
+
+void XmlStream::Drain()
+{
+	while (m_open) {
+		m_position = m_window.size();
+		Fill();
+	}
+}
@@ -0,0 +1,95 @@
+#ifndef XML_STREAM_H__
+#define XML_STREAM_H__
+
+#include "../types.h"
+#include "XmlDocument.h"
+#include "structure.h"
+#include <functional>
+#include <vector>
+
+// Pull reader of an xml file too big to be loaded and parsed as a whole. The file is read
+// through a window of fixed size and only the elements asked for are parsed, one subtree at
+// a time, so the memory needed depends on the biggest subtree read, not on the file size.
+// The reader only moves forward: the element at the cursor is entered, skipped or read.
+//   stream.Next();   // <doxygen>
+//   stream.Enter();
+//   while (stream.Next()) { if (stream.Name() == ...) stream.Read(); else stream.Skip(); }
+class XmlStream {
+public:
+	typedef std::function<void(const _TCHAR*, std::size_t)> Observer;
+
+	explicit XmlStream(const stringRef& filename);
+	~XmlStream();
+
+	// size of the file in characters
+	unsigned long long Size() const { return m_size; }
+
+	// calls `observer` with every part of the content as it is read from the file
+	void Observe(const Observer& observer) { m_observer = observer; }
+
+	// Moves to the next child element of the element entered last, the next top level element
+	// if none was. An element left at the cursor is skipped. Returns false at the end of the
+	// entered element, which is then left, or at the end of the file.
+	bool Next();
+	// name of the element at the cursor
+	stringRef Name() const;
+	// the element at the cursor with its attributes only, valid until the cursor moves on
+	Element Tag();
+	// makes the children of the element at the cursor the elements Next moves over
+	void Enter();
+	// moves past the element at the cursor
+	void Skip();
+	// Parses the element at the cursor with its subtree and moves past it. The elements
+	// named in `skipped` are left out of it, except inside the elements named in `kept`.
+	// Valid until the next Tag or Read.
+	Element Read(const std::vector<string>& skipped = std::vector<string>(), const std::vector<string>& kept = std::vector<string>());
+	// reads the rest of the file, for the observer
+	void Drain();
+
+	operator bool() const { return m_open; }
+
+private:
+	XmlStream(const XmlStream&);
+	XmlStream& operator=(const XmlStream&);
+
+	enum EMarkup {
+		START_TAG,
+		EMPTY_TAG, //!< <name/>
+		END_TAG,
+		OTHER //!< declaration, comment, processing instruction or CDATA
+	};
+
+	// Reads up to the end of the next markup, into m_markup. The text before it is appended
+	// to `text`, if given. Returns false at the end of the file.
+	bool ReadMarkup(string* text);
+	bool Get(_TCHAR& c) {
+		if (m_position == m_window.size() && !Fill()) return false;
+		c = m_window[m_position++];
+		return true;
+	}
+	bool Fill();
+	bool EndsWith(const _TCHAR* suffix) const;
+
+private:
+	bool m_open;
+	unsigned long long m_size;
+#ifdef _WIN32
+	void* m_file;
+#else
+	int m_file;
+#endif
+	std::vector<char> m_bytes; //!< read buffer, if the characters are wider than the bytes
+	std::vector<_TCHAR> m_window; //!< the part of the content read last
+	std::size_t m_position; //!< next character of m_window
+	Observer m_observer;
+
+	string m_markup; //!< the markup read last
+	EMarkup m_type; //!< type of m_markup
+	bool m_atElement; //!< m_markup is the start tag of the element at the cursor
+	bool m_leaving; //!< an empty element was entered, Next has to leave it
+
+	string m_text; //!< the subtree read last, parsed in-situ
+	XmlDocument m_document;
+};
+
+#endif // XML_STREAM_H__
@@ -1,20 +1,24 @@
 #ifndef AVG_AE1E5B36_9702_4333_B0CD_F1FCEF3C02D7_STRUCTURE_H__
 #define AVG_AE1E5B36_9702_4333_B0CD_F1FCEF3C02D7_STRUCTURE_H__
 
-#include <fstream>
 #include <vector>
-#include <map>
-#include "types.h"
+#include "../types.h"
 #include <cctype>
 #include <string>
 #include <algorithm>
+#include <iterator>
 #include <iostream>
 
 
+inline bool isSpace(_TCHAR c)
+{
+	return c == _T(' ') || c == _T('\t') || c == _T('\n') || c == _T('\r') || c == _T('\f') || c == _T('\v');
+}
+
 inline string trim(const string &s)
 {
-   auto wsfront=std::find_if_not(s.begin(),s.end(),[](int c){return std::isspace(c);});
-   auto wsback=std::find_if_not(s.rbegin(),s.rend(),[](int c){return std::isspace(c);}).base();
+   auto wsfront=std::find_if_not(s.begin(),s.end(),isSpace);
+   auto wsback=std::find_if_not(s.rbegin(),s.rend(),isSpace).base();
    return (wsback<=wsfront ? string() : string(wsfront,wsback));
 }
 
@@ -28,84 +32,151 @@ inline string replaceAll(string s, const stringRef& pattern, const stringRef& ne
     return s;
 }
 
-inline std::vector<_TCHAR> readXMLFromFile(const _TCHAR* filename) {
-	std::basic_ifstream<_TCHAR> readFile(filename);
-	if (readFile.is_open()) {
-		string fileContent((std::istreambuf_iterator<_TCHAR>(readFile)),
-                 std::istreambuf_iterator<_TCHAR>());
-		readFile.close();
+// Cuts every element named in `names` together with its whole subtree out of the zero
+// terminated, not yet parsed xml `text` of length `size`. The subtrees of the elements named
+// in `kept` are left whole, nothing is cut inside them. Elements of the same name must not
+// nest. Nothing is moved before the first cut. Returns the new length.
+inline std::size_t stripElements(_TCHAR* text, std::size_t size, const std::vector<string>& names, const std::vector<string>& kept = std::vector<string>())
+{
+	typedef std::char_traits<_TCHAR> traits;
+	const _TCHAR* const end = text + size;
+	const auto isNameEnd = [](_TCHAR c) { return c == _T('>') || c == _T('/') || c == _T(' ') || c == _T('\t') || c == _T('\r') || c == _T('\n'); };
+	const auto tagNameAt = [&](const _TCHAR* tag, const string& name) {
+		return static_cast<std::size_t>(end - tag) >= name.size() + 1 &&
+			traits::compare(tag, name.c_str(), name.size()) == 0 && isNameEnd(tag[name.size()]);
+	};
+
+	const auto nameAt = [&](const _TCHAR* tag, const std::vector<string>& list) -> const string* {
+		for (const auto& item : list) {
+			if (tagNameAt(tag, item)) return &item;
+		}
+		return nullptr;
+	};
+	// the end of the element whose name starts at `tag`, null if it is not closed
+	const auto elementEnd = [&](const _TCHAR* tag, const string& name) -> const _TCHAR* {
+		const _TCHAR* next = traits::find(tag, end - tag, _T('>'));
+		if (!next) return nullptr;
+		if (next[-1] != _T('/')) {
+			// find the closing tag
+			const _TCHAR* closing = next;
+			while ((closing = traits::find(closing, end - closing, _T('<'))) != nullptr) {
+				closing++;
+				if (*closing == _T('/') && tagNameAt(closing + 1, name)) break;
+			}
+			if (!closing) return nullptr;
+			next = traits::find(closing, end - closing, _T('>'));
+			if (!next) return nullptr;
+		}
+		return next + 1;
+	};
 
-		std::vector<_TCHAR> result(fileContent.begin(), fileContent.end());
-		result.push_back(_T('\0'));
-		return result;
+	_TCHAR* out = text;
+	const _TCHAR* pending = text; // start of the text not yet moved to out
+	const _TCHAR* tag = text;
+	while ((tag = traits::find(tag, end - tag, _T('<'))) != nullptr) {
+		tag++;
+		if (const string* name = nameAt(tag, kept)) {
+			const _TCHAR* const next = elementEnd(tag, *name);
+			if (!next) break;
+			tag = next;
+			continue;
+		}
+		const string* name = nameAt(tag, names);
+		if (!name) continue;
+
+		const _TCHAR* const next = elementEnd(tag, *name);
+		if (!next) break;
+
+		const std::size_t moved = (tag - 1) - pending;
+		if (out != pending) {
+			traits::move(out, pending, moved);
+		}
+		out += moved;
+		pending = tag = next;
 	}
 
-	return std::vector<_TCHAR>();
+	const std::size_t moved = end - pending;
+	if (out != pending) {
+		traits::move(out, pending, moved);
+	}
+	out += moved;
+	*out = _T('\0');
+	return out - text;
 }
 
+// Attributes of a parsed node, walked in document order straight on the rapidxml attribute list.
+class AttributeRange {
+public:
+	class iterator {
+	public:
+		typedef std::forward_iterator_tag iterator_category;
+		typedef const Attribute value_type;
+		typedef std::ptrdiff_t difference_type;
+		typedef const Attribute* pointer;
+		typedef const Attribute& reference;
+
+		iterator(const Attribute* attribute = nullptr) : m_attribute(attribute) {}
+
+		const Attribute& operator*() const { return *m_attribute; }
+		const Attribute* operator->() const { return m_attribute; }
+		iterator& operator++() { m_attribute = m_attribute->next_attribute(); return *this; }
+		iterator operator++(int) { iterator result(*this); ++*this; return result; }
+		bool operator==(const iterator& that) const { return m_attribute == that.m_attribute; }
+		bool operator!=(const iterator& that) const { return m_attribute != that.m_attribute; }
+
+	private:
+		const Attribute* m_attribute;
+	};
+
+	AttributeRange(const Node* node) : m_first(node ? node->first_attribute() : nullptr) {}
+
+	iterator begin() const { return m_first; }
+	iterator end() const { return iterator(); }
+	bool empty() const { return m_first == nullptr; }
+
+private:
+	const Attribute* m_first;
+};
+
+class ElementRange;
+
+// Handle of a parsed node. It is just the node pointer, copying it is free and everything
+// is looked up in the rapidxml tree on request.
 class Element {
 public:
-	Element(const Node& node) : m_node(&node) { Init(); }
-	Element(const Node* node = nullptr) : m_node(node) { Init(); }
-	Element(const Element& that) : m_node(that.m_node) { m_attributes = that.m_attributes; }
-	Element(Element&& that) : m_node(that.m_node) { std::swap(m_attributes, that.m_attributes); }
+	Element(const Node& node) : m_node(&node) {}
+	Element(const Node* node = nullptr) : m_node(node) {}
 
-	const std::map<stringRef, stringRef>& Attributes() const {
-		return m_attributes;
+	AttributeRange Attributes() const {
+		return m_node;
 	}
 
 	stringRef GetAttribute(const stringRef& name) const {
 		if (m_node)	{
-			if(Attribute *attr = m_node->first_attribute(name.str())) {
-				return attr->value();
+			if(Attribute *attr = m_node->first_attribute(name.str(), name.size())) {
+				return stringRef(attr->value(), attr->value_size());
 			}
 		}
 		return nullptr;
 	}
 
-	stringRef Text(bool recursive = true) const {
-		const stringRef firstNodeText = m_node ? stringRef(m_node->value()) : stringRef();
-		if (!recursive)	return firstNodeText;
-
-		// replace all <sp/> tags with spaces
-		if (Name() == _T("sp"))	{
-			return _T(" ");
-		}
-
-		string result(firstNodeText.str());
-		bool firstSubNode = true;
-		for (const auto& element: Elements()) {
-			if (element.Name() || !firstSubNode) {
-				if (firstSubNode) {
-					result = element.Text().str();
-				} else {
-					result.append(element.Text().str());
-				}
-			}
-			firstSubNode = false;
-		}
-
-		return result;
-	}
+	// Text of the element with its subtree, <sp/> tags replaced with spaces. The text of an
+	// element without child elements is returned straight from the parsed buffer.
+	stringRef Text(bool recursive = true) const;
+	// appends the same text as Text() to `out`, in a single pass over the subtree
+	void AppendText(string& out) const;
 
 	stringRef Name() const {
-		return m_node ? stringRef(m_node->name()) : stringRef();
+		return m_node ? stringRef(m_node->name(), m_node->name_size()) : stringRef();
 	}
 
-	std::vector<Element> Elements(const stringRef& name = nullptr) const {
-		std::vector<Element> result;
-		if (m_node)	{
-			const _TCHAR* const nameStr = name ? name.str() : nullptr;
-			for (Node *node = m_node->first_node(nameStr); node; node = node->next_sibling(nameStr)) {
-				result.push_back(node);
-			}
-		}
-		return result;
-	}
+	// Child nodes, only the elements of the given name if there is one. The name is not
+	// copied, so it is taken as a plain string, which an owning stringRef cannot stand in for.
+	ElementRange Elements(const _TCHAR* name = nullptr) const;
 
 	Element GetElement(const stringRef& name) const {
 		if (m_node)	{
-			return m_node->first_node(name.str());
+			return m_node->first_node(name.str(), name.size());
 		}
 		return nullptr;
 	}
@@ -113,17 +184,95 @@ public:
 	operator bool() const { return m_node != nullptr; }
 
 private:
-	void Init() {
-		if (m_node)	{
-			for (Attribute *attr = m_node->first_attribute(); attr; attr = attr->next_attribute()) {
-				m_attributes.insert(std::map<stringRef, stringRef>::value_type(attr->name(), attr->value()));
-			}
-		}
-	}
+	friend class ElementRange;
+
+	const Node* m_node;
+};
+
+// Children of a node, iterated in document order straight on the rapidxml sibling list,
+// without collecting them first. The name filter is not copied, it must outlive the range.
+class ElementRange {
+public:
+	class iterator {
+	public:
+		typedef std::forward_iterator_tag iterator_category;
+		typedef const Element value_type;
+		typedef std::ptrdiff_t difference_type;
+		typedef const Element* pointer;
+		typedef const Element& reference;
+
+		iterator() : m_name(nullptr), m_nameSize(0) {}
+		iterator(const Node* node, const _TCHAR* name, std::size_t nameSize) : m_element(node), m_name(name), m_nameSize(nameSize) {}
+
+		const Element& operator*() const { return m_element; }
+		const Element* operator->() const { return &m_element; }
+		iterator& operator++() { m_element.m_node = m_element.m_node->next_sibling(m_name, m_nameSize); return *this; }
+		iterator operator++(int) { iterator result(*this); ++*this; return result; }
+		bool operator==(const iterator& that) const { return m_element.m_node == that.m_element.m_node; }
+		bool operator!=(const iterator& that) const { return m_element.m_node != that.m_element.m_node; }
+
+	private:
+		Element m_element;
+		const _TCHAR* m_name;
+		std::size_t m_nameSize;
+	};
+
+	ElementRange(const Node* parent, const _TCHAR* name, std::size_t nameSize)
+		: m_name(name), m_nameSize(nameSize)
+		, m_first(parent ? parent->first_node(m_name, m_nameSize) : nullptr) {}
+
+	iterator begin() const { return iterator(m_first, m_name, m_nameSize); }
+	iterator end() const { return iterator(); }
+	bool empty() const { return m_first == nullptr; }
 
 private:
-	std::map<stringRef, stringRef> m_attributes;
-	const Node* const m_node;
+	const _TCHAR* m_name;
+	std::size_t m_nameSize;
+	const Node* m_first;
 };
 
+inline ElementRange Element::Elements(const _TCHAR* name) const
+{
+	return ElementRange(m_node, name, name ? std::char_traits<_TCHAR>::length(name) : 0);
+}
+
+inline stringRef Element::Text(bool recursive) const
+{
+	if (!m_node) return stringRef();
+
+	const Node* const child = m_node->first_node();
+	const bool flat = !child || (!*child->name() && !child->next_sibling());
+	if (!recursive || (flat && Name() != _T("sp"))) {
+		return stringRef(m_node->value(), m_node->value_size());
+	}
+
+	string result;
+	AppendText(result);
+	return stringRef(std::move(result));
+}
+
+inline void Element::AppendText(string& out) const
+{
+	if (!m_node) return;
+
+	// replace all <sp/> tags with spaces
+	if (Name() == _T("sp"))	{
+		out.push_back(_T(' '));
+		return;
+	}
+
+	// The value is the first data node among the children. If that is the first child,
+	// it is taken from the value, if the first child is an element the value is ignored.
+	const Node* child = m_node->first_node();
+	if (!child || !*child->name()) {
+		out.append(m_node->value(), m_node->value_size());
+		if (child) {
+			child = child->next_sibling();
+		}
+	}
+	for (; child; child = child->next_sibling()) {
+		Element(child).AppendText(out);
+	}
+}
+
 #endif // AVG_AE1E5B36_9702_4333_B0CD_F1FCEF3C02D7_STRUCTURE_H__